@@ -1,10 +1,25 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <cstddef>
 #include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include "Noexcept.h"
+#include "UniquePtr.h"
+
+// std::pmr::memory_resource is C++17; ClonePtrPmrAllocator is only defined where it is available.
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+#include <memory_resource>
+#define CI0_HAS_MEMORY_RESOURCE 1
+#endif
+#endif
 
 #if _MSC_VER
 #pragma warning(push)
@@ -14,94 +29,552 @@
 
 namespace ci0 {
 
-    struct IClonePtrCloner
+    // Heap fallback for objects that do not fit in an SBO.
+    // Before C++17, operator new ignores over-alignment, so over-aligned Objects get an
+    // explicitly aligned allocation instead.  (attach() of such objects is unsupported there)
+    template <class Object, bool OverAligned = (alignof(Object) > alignof(std::max_align_t))>
+    struct ClonePtrHeap
     {
-        const size_t sizeofObject;
+        template <class... Args>
+        static Object* New(Args&&... args)
+        {
+            return new Object(std::forward<Args>(args)...);
+        }
+        static void Delete(Object* pObject)
+        {
+            delete pObject;
+        }
+    };
 
-        virtual ~IClonePtrCloner() {}
-        IClonePtrCloner(size_t sizeofObject_)
-            : sizeofObject(sizeofObject_)
+#if !defined(__cpp_aligned_new)
+    template <class Object>
+    struct ClonePtrHeap<Object, true>
+    {
+        static void* Allocate()
         {
+            void* pMem = nullptr;
+#if _MSC_VER
+            pMem = _aligned_malloc(sizeof(Object), alignof(Object));
+#else
+            if (posix_memalign(&pMem, alignof(Object), sizeof(Object)))
+            {
+                pMem = nullptr;
+            }
+#endif
+            if (!pMem)
+            {
+                throw std::bad_alloc();
+            }
+            return pMem;
+        }
+        static void Deallocate(void* pMem)
+        {
+#if _MSC_VER
+            _aligned_free(pMem);
+#else
+            free(pMem);
+#endif
         }
 
-        virtual char* Copy(const char* pRhsObj, char* pSbo, size_t sboSize) const = 0;
-        virtual char* Move(char* pRhsObj, char* pSbo, size_t sboSize) const = 0;
-        virtual void Destruct(char* pObj, char* pSbo, size_t sboSize) const = 0;
+        template <class... Args>
+        static Object* New(Args&&... args)
+        {
+            void* pMem = Allocate();
+            try
+            {
+                return new (pMem) Object(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                Deallocate(pMem);
+                throw;
+            }
+        }
+        static void Delete(Object* pObject)
+        {
+            pObject->~Object();
+            Deallocate(pObject);
+        }
     };
+#endif
+
+    // Returns true if Object may be placed in an SBO of the given size and alignment.
+    // Objects must also be nothrow-move-constructible, so that ClonePtr moves stay noexcept.
+    template <class Object>
+    inline bool ClonePtrFitsInSbo(size_t sboSize, size_t sboAlign)
+    {
+        return std::is_nothrow_move_constructible<Object>::value && sizeof(Object) <= sboSize && alignof(Object) <= sboAlign;
+    }
 
+    // An Object is trivially relocatable if move-constructing it to a new address and destructing
+    // the original is equivalent to a memcpy.  That holds for most types that do not point into themselves;
+    // specialize this for such types (e.g. classes holding a UniquePtr) to enable ClonePtr's memcpy fast path.
     template <class Object>
-    struct ClonePtrCloner : public IClonePtrCloner
+    struct IsTriviallyRelocatable : std::is_trivially_copyable<Object>
     {
-        ClonePtrCloner()
-            : IClonePtrCloner(sizeof(Object))
+    };
+
+    // IClonePtrMover is the subset of IClonePtrCloner needed by move-only holders (InplacePtr).
+    // Cloners are plain tables of function pointers rather than polymorphic objects: they have constexpr
+    // constructors and trivial destructors, so every Instance is constant-initialized (no startup cost,
+    // no guard variables) and may be placed in read-only memory.  This also makes ClonePtrs safe to use
+    // from the dynamic initializers of other globals.
+    // Copy/Move/Destruct are inline wrappers that test flags first, so that trivial Objects (e.g. most
+    // lambdas) are handled with a memcpy or nothing at all, instead of an indirect call.
+    struct IClonePtrMover
+    {
+        typedef char* MoveFn(char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign);
+        typedef void MoveConstructFn(char* pRhsObj, char* pDst);
+        typedef void DestroyFn(char* pObj);
+
+        size_t sizeofObject;
+        size_t alignofObject;
+        bool isNothrowMoveConstructible;
+        bool isTriviallyRelocatable;
+        // Trivially copyable (and nothrow-movable) Objects are copied and moved into an SBO with memcpy.
+        bool isTriviallyCopyable;
+        // Trivially destructible Objects in an SBO need no call at all to be destroyed.
+        bool isTriviallyDestructible;
+        MoveFn* pMove;
+        // Move-constructs into caller-provided storage.  Only called when isNothrowMoveConstructible == true.
+        MoveConstructFn* pMoveConstruct;
+        DestroyFn* pDestroyInPlace;
+        DestroyFn* pDelete;
+
+        constexpr IClonePtrMover(size_t sizeofObject_, size_t alignofObject_, bool isNothrowMoveConstructible_, bool isTriviallyRelocatable_, bool isTriviallyCopyable_, bool isTriviallyDestructible_,
+            MoveFn* pMove_, MoveConstructFn* pMoveConstruct_, DestroyFn* pDestroyInPlace_, DestroyFn* pDelete_)
+            : sizeofObject(sizeofObject_)
+            , alignofObject(alignofObject_)
+            , isNothrowMoveConstructible(isNothrowMoveConstructible_)
+            , isTriviallyRelocatable(isTriviallyRelocatable_)
+            , isTriviallyCopyable(isTriviallyCopyable_)
+            , isTriviallyDestructible(isTriviallyDestructible_)
+            , pMove(pMove_)
+            , pMoveConstruct(pMoveConstruct_)
+            , pDestroyInPlace(pDestroyInPlace_)
+            , pDelete(pDelete_)
         {
         }
 
-        virtual char* Copy(const char* pRhsObj, char* pSbo, size_t sboSize) const
+        // Same result as ClonePtrFitsInSbo<Object>.
+        bool FitsInSbo(size_t sboSize, size_t sboAlign) const
         {
-            const Object& rhs = *(Object*)pRhsObj;
+            return isNothrowMoveConstructible && sizeofObject <= sboSize && alignofObject <= sboAlign;
+        }
 
-            // In ClonePtr<>, the copy-assignment operator must copy-then-move to be exception-safe.
-            // This requires the move to be noexcept.
-            if (std::is_nothrow_move_constructible<Object>::value)
+        // Move-constructs the object at pRhsObj into pSbo if it fits, or else onto the heap.
+        // Only called for nothrow-move-constructible Objects.
+        char* Move(char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign) const
+        {
+            if (isTriviallyCopyable && FitsInSbo(sboSize, sboAlign))
             {
-                if (sizeof(Object) <= sboSize)
+                memcpy(pSbo, pRhsObj, sizeofObject);
+                return pSbo;
+            }
+            return pMove(pRhsObj, pSbo, sboSize, sboAlign);
+        }
+
+        // Destroys the object, and frees it if it is not in the SBO.
+        void Destruct(char* pObj, char* pSbo, size_t sboSize) const
+        {
+            if (uintptr_t(pObj - pSbo) < sboSize)
+            {
+                if (!isTriviallyDestructible)
                 {
-                    Object* pNew = new (pSbo) Object(rhs);
-                    return (char*)pNew;
+                    pDestroyInPlace(pObj);
                 }
+                return;
             }
+            pDelete(pObj);
+        }
+    };
 
-            Object* pNew = new Object(rhs);
-            return (char*)pNew;
+    struct IClonePtrCloner : public IClonePtrMover
+    {
+        typedef char* CopyFn(const char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign);
+        typedef void CopyConstructFn(const char* pRhsObj, char* pDst);
+        typedef void CopyAssignFn(char* pObj, const char* pRhsObj);
+
+        bool isNothrowCopyAssignable;
+        CopyFn* pCopy;
+        // Copy-constructs into caller-provided storage.
+        CopyConstructFn* pCopyConstruct;
+        CopyAssignFn* pCopyAssign;
+
+        constexpr IClonePtrCloner(const IClonePtrMover& mover, bool isNothrowCopyAssignable_, CopyFn* pCopy_, CopyConstructFn* pCopyConstruct_, CopyAssignFn* pCopyAssign_)
+            : IClonePtrMover(mover)
+            , isNothrowCopyAssignable(isNothrowCopyAssignable_)
+            , pCopy(pCopy_)
+            , pCopyConstruct(pCopyConstruct_)
+            , pCopyAssign(pCopyAssign_)
+        {
         }
 
+        // Copy-constructs the object at pRhsObj into pSbo if it fits, or else onto the heap.
+        char* Copy(const char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign) const
+        {
+            if (isTriviallyCopyable && FitsInSbo(sboSize, sboAlign))
+            {
+                memcpy(pSbo, pRhsObj, sizeofObject);
+                return pSbo;
+            }
+            return pCopy(pRhsObj, pSbo, sboSize, sboAlign);
+        }
+
+        // Copy-assigns one existing Object onto another.  Only called when isNothrowCopyAssignable == true.
+        void CopyAssign(char* pObj, const char* pRhsObj) const
+        {
+            if (isTriviallyCopyable)
+            {
+                memcpy(pObj, pRhsObj, sizeofObject);
+                return;
+            }
+            pCopyAssign(pObj, pRhsObj);
+        }
+    };
+
+    // Implements the move-only operations.
+    // Kept separate from ClonePtrCloner so that move-only Objects never instantiate Copy().
+    template <class Object>
+    struct ClonePtrMoverImpl
+    {
         // Move() is only called when is_nothrow_move_constructible<Object>::value == true.
-        virtual char* Move(char* pRhsObj, char* pSbo, size_t sboSize) const
+        static char* Move(char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign)
+        {
+            return MoveImpl(pRhsObj, pSbo, sboSize, sboAlign, std::is_nothrow_move_constructible<Object>());
+        }
+        static char* MoveImpl(char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign, std::true_type)
         {
             Object& rhs = *(Object*)pRhsObj;
-            if (sizeof(Object) <= sboSize)
+            if (ClonePtrFitsInSbo<Object>(sboSize, sboAlign))
             {
                 Object* pNew = new (pSbo) Object(std::move(rhs));
                 return (char*)pNew;
             }
 
-            Object* pNew = new Object(std::move(rhs));
+            Object* pNew = ClonePtrHeap<Object>::New(std::move(rhs));
             return (char*)pNew;
         }
+        static char* MoveImpl(char*, char*, size_t, size_t, std::false_type)
+        {
+            // never called; allows emplace() of non-movable Objects (which always live on the heap)
+            assert(false);
+            return nullptr;
+        }
 
-        virtual void Destruct(char* pObj, char* pSbo, size_t sboSize) const
+        static void MoveConstruct(char* pRhsObj, char* pDst)
         {
-            Object* pObject = (Object*)pObj;
-            if (uintptr_t(pObj - pSbo) < sboSize)
+            MoveConstructImpl(pRhsObj, pDst, std::is_nothrow_move_constructible<Object>());
+        }
+        static void MoveConstructImpl(char* pRhsObj, char* pDst, std::true_type)
+        {
+            new (pDst) Object(std::move(*(Object*)pRhsObj));
+        }
+        static void MoveConstructImpl(char*, char*, std::false_type)
+        {
+            // never called; see isNothrowMoveConstructible
+            assert(false);
+        }
+
+        static void DestroyInPlace(char* pObj)
+        {
+            ((Object*)pObj)->~Object();
+        }
+        static void Delete(char* pObj)
+        {
+            ClonePtrHeap<Object>::Delete((Object*)pObj);
+        }
+
+        static constexpr IClonePtrMover MakeMover()
+        {
+            return IClonePtrMover(sizeof(Object), alignof(Object), std::is_nothrow_move_constructible<Object>::value, IsTriviallyRelocatable<Object>::value,
+                std::is_trivially_copyable<Object>::value && std::is_nothrow_move_constructible<Object>::value,
+                std::is_trivially_destructible<Object>::value,
+                &Move, &MoveConstruct, &DestroyInPlace, &Delete);
+        }
+    };
+
+    template <class Object>
+    struct ClonePtrMover : public ClonePtrMoverImpl<Object>
+    {
+        static const IClonePtrMover Instance;
+    };
+
+    template <class Object>
+    const IClonePtrMover ClonePtrMover<Object>::Instance = ClonePtrMoverImpl<Object>::MakeMover();
+
+    template <class Object>
+    struct ClonePtrCloner : public ClonePtrMoverImpl<Object>
+    {
+        static char* Copy(const char* pRhsObj, char* pSbo, size_t sboSize, size_t sboAlign)
+        {
+            const Object& rhs = *(Object*)pRhsObj;
+
+            // In ClonePtr<>, the copy-assignment operator must copy-then-move to be exception-safe.
+            // This requires the move to be noexcept.
+            if (ClonePtrFitsInSbo<Object>(sboSize, sboAlign))
             {
-                pObject->~Object();
-                return;
+                Object* pNew = new (pSbo) Object(rhs);
+                return (char*)pNew;
             }
 
-            delete pObject;
+            Object* pNew = ClonePtrHeap<Object>::New(rhs);
+            return (char*)pNew;
         }
 
-        static ClonePtrCloner<Object> Instance;
+        static void CopyConstruct(const char* pRhsObj, char* pDst)
+        {
+            new (pDst) Object(*(const Object*)pRhsObj);
+        }
+
+        static void CopyAssign(char* pObj, const char* pRhsObj)
+        {
+            CopyAssignImpl(pObj, pRhsObj, std::is_nothrow_copy_assignable<Object>());
+        }
+        static void CopyAssignImpl(char* pObj, const char* pRhsObj, std::true_type)
+        {
+            *(Object*)pObj = *(const Object*)pRhsObj;
+        }
+        static void CopyAssignImpl(char*, const char*, std::false_type)
+        {
+            // never called; see isNothrowCopyAssignable
+            assert(false);
+        }
+
+        static const IClonePtrCloner Instance;
     };
 
     template <class Object>
-    ClonePtrCloner<Object> ClonePtrCloner<Object>::Instance;
+    const IClonePtrCloner ClonePtrCloner<Object>::Instance(
+        ClonePtrMoverImpl<Object>::MakeMover(),
+        std::is_nothrow_copy_assignable<Object>::value,
+        &ClonePtrCloner<Object>::Copy,
+        &ClonePtrCloner<Object>::CopyConstruct,
+        &ClonePtrCloner<Object>::CopyAssign);
+
+    // Default SBO alignment: the largest power of two that is <= sboSize, capped at max_align_t.
+    // An Object only fits in the SBO if sizeof(Object) <= sboSize, which implies alignof(Object) <= sboSize,
+    // so aligning the SBO any further would only add padding.
+    constexpr size_t ClonePtrDefaultAlign(size_t sboSize, size_t align = alignof(std::max_align_t))
+    {
+        return (align <= sboSize || align == 1) ? align : ClonePtrDefaultAlign(sboSize, align / 2);
+    }
 
-    template <class Interface, size_t SboSize = sizeof(void*)>
-    class ClonePtr
+    // Allocation policies for objects that do not fit in the SBO of a ClonePtr or Function.
+    // The holder stores its policy as an empty base, so a stateless policy costs nothing.  A policy provides:
+    //      Object* New<Object>(args...)            constructs an Object in new storage
+    //      char* NewCopy(pCloner, pRhsObj)         copy-constructs *pRhsObj into new storage
+    //      char* NewMove(pCloner, pRhsObj)         move-constructs (or copies, if moving may throw) into new storage
+    //      void Delete(pMover, pObj)               destroys and frees an object returned by the above
+    //      Policy SelectOnCopy() const             the policy of a copy-constructed holder
+    //      bool IsEqual(const Policy&) const       true if each policy can Delete the other's objects
+    // A holder's policy travels with it on move-construction, move-assignment and swap, and is chosen by
+    // SelectOnCopy() on copy-construction; copy-assignment keeps the destination's policy.
+    // Holders with different policy types exchange objects by relocating them.
+
+    // Default policy: the global operator new/delete, through ClonePtrHeap.
+    struct ClonePtrNewDelete
+    {
+        template <class Object, class... Args>
+        Object* New(Args&&... args) const
+        {
+            return ClonePtrHeap<Object>::New(std::forward<Args>(args)...);
+        }
+        char* NewCopy(const IClonePtrCloner* pCloner, const char* pRhsObj) const
+        {
+            return pCloner->pCopy(pRhsObj, nullptr, 0u, 0u);
+        }
+        char* NewMove(const IClonePtrCloner* pCloner, char* pRhsObj) const
+        {
+            if (pCloner->isNothrowMoveConstructible)
+            {
+                return pCloner->pMove(pRhsObj, nullptr, 0u, 0u);
+            }
+            return pCloner->pCopy(pRhsObj, nullptr, 0u, 0u);
+        }
+        void Delete(const IClonePtrMover* pMover, char* pObj) const
+        {
+            pMover->pDelete(pObj);
+        }
+        ClonePtrNewDelete SelectOnCopy() const
+        {
+            return *this;
+        }
+        bool IsEqual(const ClonePtrNewDelete&) const
+        {
+            return true;
+        }
+    };
+
+    // Policy that allocates from a memory resource, e.g. a per-request arena or a per-NUMA-node pool.
+    // Resource must provide the std::pmr::memory_resource interface:
+    //      void* allocate(size_t bytes, size_t alignment);
+    //      void deallocate(void* p, size_t bytes, size_t alignment);
+    // The resource is not owned, and must outlive every holder that uses it.  Copies share the resource.
+    template <class Resource>
+    struct ClonePtrResourceAllocator
+    {
+        Resource* pResource;
+
+        ClonePtrResourceAllocator()
+            : pResource(nullptr)
+        {
+        }
+        explicit ClonePtrResourceAllocator(Resource* pResource_)
+            : pResource(pResource_)
+        {
+        }
+
+        template <class Object, class... Args>
+        Object* New(Args&&... args) const
+        {
+            char* pMem = Allocate(sizeof(Object), alignof(Object));
+            try
+            {
+                return new (pMem) Object(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                pResource->deallocate(pMem, sizeof(Object), alignof(Object));
+                throw;
+            }
+        }
+        char* NewCopy(const IClonePtrCloner* pCloner, const char* pRhsObj) const
+        {
+            char* pMem = Allocate(pCloner->sizeofObject, pCloner->alignofObject);
+            try
+            {
+                pCloner->pCopyConstruct(pRhsObj, pMem);
+            }
+            catch (...)
+            {
+                pResource->deallocate(pMem, pCloner->sizeofObject, pCloner->alignofObject);
+                throw;
+            }
+            return pMem;
+        }
+        char* NewMove(const IClonePtrCloner* pCloner, char* pRhsObj) const
+        {
+            if (!pCloner->isNothrowMoveConstructible)
+            {
+                return NewCopy(pCloner, pRhsObj);
+            }
+            char* pMem = Allocate(pCloner->sizeofObject, pCloner->alignofObject);
+            pCloner->pMoveConstruct(pRhsObj, pMem);
+            return pMem;
+        }
+        void Delete(const IClonePtrMover* pMover, char* pObj) const
+        {
+            if (!pMover->isTriviallyDestructible)
+            {
+                pMover->pDestroyInPlace(pObj);
+            }
+            pResource->deallocate(pObj, pMover->sizeofObject, pMover->alignofObject);
+        }
+        ClonePtrResourceAllocator SelectOnCopy() const
+        {
+            return *this;
+        }
+        bool IsEqual(const ClonePtrResourceAllocator& rhs) const
+        {
+            return pResource == rhs.pResource;
+        }
+
+    private:
+        char* Allocate(size_t size, size_t align) const
+        {
+            assert(pResource);
+            return (char*)pResource->allocate(size, align);
+        }
+    };
+
+    // Allocator propagation between holders.  Holders with different Alloc types never share an allocator:
+    // they default-construct their own, and objects are relocated between them.
+    template <class Alloc, class RhsAlloc>
+    struct ClonePtrAllocTraits
+    {
+        static Alloc SelectOnCopy(const RhsAlloc&)
+        {
+            return Alloc();
+        }
+        static Alloc SelectOnMove(const RhsAlloc&)
+        {
+            return Alloc();
+        }
+        static void Propagate(Alloc&, const RhsAlloc&)
+        {
+        }
+        static bool IsEqual(const Alloc&, const RhsAlloc&)
+        {
+            return false;
+        }
+    };
+    template <class Alloc>
+    struct ClonePtrAllocTraits<Alloc, Alloc>
+    {
+        static Alloc SelectOnCopy(const Alloc& rhs)
+        {
+            return rhs.SelectOnCopy();
+        }
+        static Alloc SelectOnMove(const Alloc& rhs)
+        {
+            return rhs;
+        }
+        static void Propagate(Alloc& alloc, const Alloc& rhs)
+        {
+            alloc = rhs;
+        }
+        static bool IsEqual(const Alloc& alloc, const Alloc& rhs)
+        {
+            return alloc.IsEqual(rhs);
+        }
+    };
+
+#if CI0_HAS_MEMORY_RESOURCE
+    // Policy over std::pmr::memory_resource, with std::pmr::polymorphic_allocator's propagation rules:
+    // default-constructed and copy-constructed holders use std::pmr::get_default_resource().
+    struct ClonePtrPmrAllocator : public ClonePtrResourceAllocator<std::pmr::memory_resource>
+    {
+        ClonePtrPmrAllocator()
+            : ClonePtrResourceAllocator<std::pmr::memory_resource>(std::pmr::get_default_resource())
+        {
+        }
+        ClonePtrPmrAllocator(std::pmr::memory_resource* pResource_)
+            : ClonePtrResourceAllocator<std::pmr::memory_resource>(pResource_)
+        {
+        }
+        ClonePtrPmrAllocator SelectOnCopy() const
+        {
+            return ClonePtrPmrAllocator();
+        }
+        bool IsEqual(const ClonePtrPmrAllocator& rhs) const
+        {
+            return pResource == rhs.pResource || pResource->is_equal(*rhs.pResource);
+        }
+    };
+#endif
+
+    // Layout: an object that lives in the SBO starts at m_sbo; a heap object's address is stored in the
+    // first bytes of m_sbo instead.  The object pointer is thus derived rather than stored, and
+    // m_pInterface alone tells which case applies (it points into m_sbo iff the object lives there).
+    //      sizeof(ClonePtr<Base>) == 3*sizeof(void*)
+    // Objects that do not fit in the SBO are allocated through Alloc; see ClonePtrNewDelete.
+    template <class Interface, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize), class Alloc = ClonePtrNewDelete>
+    class ClonePtr : private Alloc
     {
     public:
-        typedef ClonePtr<Interface, SboSize> This;
+        typedef ClonePtr<Interface, SboSize, Align, Alloc> This;
 
-        template <class RhsInterface, size_t RhsSboSize>
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
         friend class ClonePtr;
 
     private:
+        static const size_t SboStorageSize = (SboSize < sizeof(char*)) ? sizeof(char*) : SboSize;
+        static const size_t SboStorageAlign = (Align < alignof(char*)) ? alignof(char*) : Align;
+
         Interface* m_pInterface;
-        char* m_pObject;
         const IClonePtrCloner* m_pCloner;
-        char m_sbo[SboSize];
+        alignas(SboStorageAlign) char m_sbo[SboStorageSize];
 
     private:
         template <class Src, class Dst>
@@ -119,21 +592,79 @@ namespace ci0 {
         operator PreventDelete*() const;
 
     private:
-        // NOTE: Release() leaves m_pObject etc. pointing at a destructed object.
+        // NOTE: Release() leaves m_pInterface etc. pointing at a destructed object.
         // Callers must subsequently call some Init*() function (except in ~ClonePtr).
         void Release()
         {
-            if (m_pInterface)
+            if (!m_pInterface)
+            {
+                return;
+            }
+            if (IsObjectInSboBuffer())
             {
-                m_pCloner->Destruct(m_pObject, m_sbo, SboSize);
+                if (!m_pCloner->isTriviallyDestructible)
+                {
+                    m_pCloner->pDestroyInPlace(m_sbo);
+                }
+                return;
             }
+            GetAlloc().Delete(m_pCloner, ObjectPtr());
         }
 
         void InitNull()
         {
             m_pInterface = nullptr;
-            m_pObject = nullptr;
             m_pCloner = nullptr;
+            SetObjectPtr(nullptr);
+        }
+
+        Alloc& GetAlloc()
+        {
+            return *this;
+        }
+        const Alloc& GetAlloc() const
+        {
+            return *this;
+        }
+
+        bool IsObjectInSboBuffer() const
+        {
+            bool result = uintptr_t((const char*)m_pInterface - m_sbo) < SboSize;
+            return result;
+        }
+        char* ObjectPtr() const
+        {
+            if (IsObjectInSboBuffer())
+            {
+                return (char*)m_sbo;
+            }
+            return *(char* const*)m_sbo;
+        }
+        // Records the location of a newly placed object; a no-op for objects placed in the SBO.
+        void SetObjectPtr(char* pObject)
+        {
+            if (pObject != m_sbo)
+            {
+                new (m_sbo) char*(pObject);
+            }
+        }
+
+        // Copies or moves an object into the SBO if it fits, or else into storage from the allocator.
+        char* CopyObject(const IClonePtrCloner* pCloner, const char* pRhsObject)
+        {
+            if (pCloner->FitsInSbo(SboSize, Align))
+            {
+                return pCloner->Copy(pRhsObject, m_sbo, SboSize, Align);
+            }
+            return GetAlloc().NewCopy(pCloner, pRhsObject);
+        }
+        char* MoveObject(const IClonePtrCloner* pCloner, char* pRhsObject)
+        {
+            if (pCloner->FitsInSbo(SboSize, Align))
+            {
+                return pCloner->Move(pRhsObject, m_sbo, SboSize, Align);
+            }
+            return GetAlloc().NewMove(pCloner, pRhsObject);
         }
 
         // NOTE: InitCopy*() and InitMove*() are written out to produce clear error messages when
@@ -147,33 +678,92 @@ namespace ci0 {
         // versus: (clear)
         //      error: assigning to 'Derived *' from incompatible type 'Base *'
 
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitCopy_ImplicitCast(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy_ImplicitCast(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
             InitNull(); // reset members here, in case Copy() throws
             if (!rhs.m_pInterface)
             {
                 return;
             }
-            m_pObject = rhs.m_pCloner->Copy(rhs.m_pObject, m_sbo, SboSize);
-            m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject));
+            char* pRhsObject = rhs.ObjectPtr();
+            char* pObject = CopyObject(rhs.m_pCloner, pRhsObject);
+            SetObjectPtr(pObject);
+            m_pInterface = (RhsInterface*)(pObject + ((char*)rhs.m_pInterface - pRhsObject));
             m_pCloner = rhs.m_pCloner;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitCopy_StaticCast(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy_StaticCast(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
             InitNull(); // reset members here, in case Copy() throws
             if (!rhs.m_pInterface)
             {
                 return;
             }
-            m_pObject = rhs.m_pCloner->Copy(rhs.m_pObject, m_sbo, SboSize);
-            m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject)));
+            char* pRhsObject = rhs.ObjectPtr();
+            char* pObject = CopyObject(rhs.m_pCloner, pRhsObject);
+            SetObjectPtr(pObject);
+            m_pInterface = static_cast<Interface*>((RhsInterface*)(pObject + ((char*)rhs.m_pInterface - pRhsObject)));
             m_pCloner = rhs.m_pCloner;
         }
 
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitMove_ImplicitCast(ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        // Copy-assignment.  When both sides hold the same concrete type and its copy-assignment
+        // cannot throw, the existing object (and its storage) is reused in-place.
+        // Otherwise copy-then-move, for exception safety.
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void AssignCopy_ImplicitCast(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            if (m_pInterface && m_pCloner == rhs.m_pCloner && m_pCloner->isNothrowCopyAssignable)
+            {
+                char* pObject = ObjectPtr();
+                char* pRhsObject = rhs.ObjectPtr();
+                m_pCloner->CopyAssign(pObject, pRhsObject);
+                m_pInterface = (RhsInterface*)(pObject + ((char*)rhs.m_pInterface - pRhsObject));
+                return;
+            }
+
+            This other(std::allocator_arg, GetAlloc());
+            other.InitCopy_ImplicitCast(rhs);
+            Release();
+            InitMove_ImplicitCast(std::move(other));
+        }
+
+        // Moves rhs's SBO-resident object into this ClonePtr (SBO or heap), destructs the original,
+        // and returns the new object pointer.  Trivially relocatable objects are memcpy'd instead.
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        char* RelocateFromSbo(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            const IClonePtrCloner* pCloner = rhs.m_pCloner;
+            if (pCloner->isTriviallyRelocatable &&
+                (RhsSboSize <= SboSize || pCloner->sizeofObject <= SboSize) &&
+                (RhsAlign <= Align || pCloner->alignofObject <= Align))
+            {
+                // The object starts at rhs.m_sbo and fits in both buffers, so a fixed-size copy suffices.
+                memcpy(m_sbo, rhs.SboBuffer(), (RhsSboSize < SboSize) ? RhsSboSize : SboSize);
+                return m_sbo;
+            }
+
+            char* pObject = MoveObject(pCloner, rhs.SboBuffer());
+            pCloner->Destruct(rhs.SboBuffer(), rhs.SboBuffer(), RhsSboSize);
+            SetObjectPtr(pObject);
+            return pObject;
+        }
+
+        // Moves rhs's heap object into storage of our own, when our allocator cannot free it,
+        // frees the original, and returns the new object pointer.
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        char* RelocateFromHeap(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            const IClonePtrCloner* pCloner = rhs.m_pCloner;
+            char* pRhsObject = rhs.ObjectPtr();
+            char* pObject = MoveObject(pCloner, pRhsObject);
+            rhs.GetAlloc().Delete(pCloner, pRhsObject);
+            SetObjectPtr(pObject);
+            return pObject;
+        }
+
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove_ImplicitCast(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
             if (!rhs.m_pInterface)
             {
@@ -183,9 +773,20 @@ namespace ci0 {
 
             if (rhs.IsObjectInSboBuffer())
             {
-                // we cannot steal the object pointer; the move-constructor must be invoked dynamically
-                m_pObject = rhs.m_pCloner->Move(rhs.m_pObject, m_sbo, SboSize);
-                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject));
+                // we cannot steal the object pointer; relocate the object instead
+                char* pObject = RelocateFromSbo(rhs);
+                m_pInterface = (RhsInterface*)(pObject + ((char*)rhs.m_pInterface - rhs.SboBuffer()));
+                m_pCloner = rhs.m_pCloner;
+                rhs.InitNull();
+                return;
+            }
+
+            if (!ClonePtrAllocTraits<Alloc, RhsAlloc>::IsEqual(GetAlloc(), rhs.GetAlloc()))
+            {
+                // rhs's allocator differs from ours; relocate the object instead
+                char* pRhsObject = rhs.ObjectPtr();
+                char* pObject = RelocateFromHeap(rhs);
+                m_pInterface = (RhsInterface*)(pObject + ((char*)rhs.m_pInterface - pRhsObject));
                 m_pCloner = rhs.m_pCloner;
                 rhs.InitNull();
                 return;
@@ -193,12 +794,12 @@ namespace ci0 {
 
             // steal the object pointer
             m_pInterface = rhs.m_pInterface;
-            m_pObject = rhs.m_pObject;
+            SetObjectPtr(rhs.ObjectPtr());
             m_pCloner = rhs.m_pCloner;
             rhs.InitNull();
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitMove_StaticCast(ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove_StaticCast(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
             if (!rhs.m_pInterface)
             {
@@ -208,17 +809,28 @@ namespace ci0 {
 
             if (rhs.IsObjectInSboBuffer())
             {
-                // we cannot steal the object pointer; the move-constructor must be invoked dynamically
-                m_pObject = rhs.m_pCloner->Move(rhs.m_pObject, m_sbo, SboSize);
-                m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject)));
+                // we cannot steal the object pointer; relocate the object instead
+                char* pObject = RelocateFromSbo(rhs);
+                m_pInterface = static_cast<Interface*>((RhsInterface*)(pObject + ((char*)rhs.m_pInterface - rhs.SboBuffer())));
+                m_pCloner = rhs.m_pCloner;
+                rhs.InitNull();
+                return;
+            }
+
+            if (!ClonePtrAllocTraits<Alloc, RhsAlloc>::IsEqual(GetAlloc(), rhs.GetAlloc()))
+            {
+                // rhs's allocator differs from ours; relocate the object instead
+                char* pRhsObject = rhs.ObjectPtr();
+                char* pObject = RelocateFromHeap(rhs);
+                m_pInterface = static_cast<Interface*>((RhsInterface*)(pObject + ((char*)rhs.m_pInterface - pRhsObject)));
                 m_pCloner = rhs.m_pCloner;
                 rhs.InitNull();
                 return;
             }
 
             // steal the object pointer
-            m_pInterface = rhs.m_pInterface;
-            m_pObject = rhs.m_pObject;
+            m_pInterface = static_cast<Interface*>(rhs.m_pInterface);
+            SetObjectPtr(rhs.ObjectPtr());
             m_pCloner = rhs.m_pCloner;
             rhs.InitNull();
         }
@@ -232,35 +844,51 @@ namespace ci0 {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wplacement-new"
 #endif
-        // Takes an Object that implements Interface, allocates a second instance of
-        // that Object, and either copy or move constructs into the second instance.
-        template <class Object, class CastToInterface>
-        void AssignObjectValue(Object&& obj, CastToInterface&& castToInterface)
+        // Constructs an Obj that implements Interface directly in its final location (SBO or heap).
+        template <class Obj, class CastToInterface, class... Args>
+        void EmplaceObject(CastToInterface&& castToInterface, Args&&... args)
         {
             InitNull(); // reset members here, in case the constructor throws
-            typedef typename std::decay<Object>::type Obj;
-            if (std::is_nothrow_move_constructible<Obj>::value && sizeof(Obj) <= SboSize)
+            if (ClonePtrFitsInSbo<Obj>(SboSize, Align))
             {
-                Obj* pObject = new (m_sbo) Obj(std::forward<Object>(obj));
+                Obj* pObject = new (m_sbo) Obj(std::forward<Args>(args)...);
                 m_pInterface = castToInterface(pObject);
-                m_pObject = (char*)pObject;
             }
             else
             {
-                Obj* pObject = new Obj(std::forward<Object>(obj));
+                Obj* pObject = GetAlloc().template New<Obj>(std::forward<Args>(args)...);
                 m_pInterface = castToInterface(pObject);
-                m_pObject = (char*)pObject;
+                SetObjectPtr((char*)pObject);
             }
             m_pCloner = &ClonePtrCloner<Obj>::Instance;
         }
+
+        // Takes an Object that implements Interface, allocates a second instance of
+        // that Object, and either copy or move constructs into the second instance.
+        template <class Object, class CastToInterface>
+        void AssignObjectValue(Object&& obj, CastToInterface&& castToInterface)
+        {
+            typedef typename std::decay<Object>::type Obj;
+            EmplaceObject<Obj>(std::forward<CastToInterface>(castToInterface), std::forward<Object>(obj));
+        }
 #if defined(__GNUC__)
 #pragma GCC diagnostic pop
 #endif
 
-        bool IsObjectInSboBuffer() const
+        char* SboBuffer()
         {
-            bool result = (m_pObject - m_sbo) < SboSize;
-            return result;
+            return m_sbo;
+        }
+        // Precondition: this object lives in the SBO, rhs is null or on the heap.
+        void SwapSboWithHeap(This& rhs)
+        {
+            Interface* pRhsInterface = rhs.m_pInterface;
+            char* pRhsObject = rhs.ObjectPtr();
+            const IClonePtrCloner* pRhsCloner = rhs.m_pCloner;
+            rhs.InitMove_ImplicitCast(std::move(*this));
+            m_pInterface = pRhsInterface;
+            SetObjectPtr(pRhsObject);
+            m_pCloner = pRhsCloner;
         }
 
     public:
@@ -277,40 +905,56 @@ namespace ci0 {
         {
             InitNull();
         }
+        // Allocates objects that do not fit in the SBO through alloc.
+        //      ClonePtr<Base, 8, 8, ArenaAlloc> pBase(std::allocator_arg, ArenaAlloc(&arena));
+        ClonePtr(std::allocator_arg_t, const Alloc& alloc) CI0_NOEXCEPT(true)
+            : Alloc(alloc)
+        {
+            InitNull();
+        }
 
         ClonePtr(const This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy_ImplicitCast(rhs);
         }
         ClonePtr(const This&& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy_ImplicitCast(rhs);
         }
         ClonePtr(This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy_ImplicitCast(rhs);
         }
         ClonePtr(This&& rhs) CI0_NOEXCEPT(true)
+            : Alloc(rhs.GetAlloc())
         {
             InitMove_ImplicitCast(std::move(rhs));
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy_ImplicitCast(rhs);
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy_ImplicitCast(rhs);
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy_ImplicitCast(rhs);
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(ClonePtr<RhsInterface, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        // note: moving between different Alloc types relocates the object, which may allocate
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnMove(rhs.GetAlloc()))
         {
             InitMove_ImplicitCast(std::move(rhs));
         }
@@ -322,13 +966,25 @@ namespace ci0 {
             AssignObjectValue(std::forward<Object>(obj), CastImplicit<Object, Interface>());
         }
 
+        // Takes ownership of pUnique's object, keeping its allocation.  Same requirements as attach().
+        // note: Object must be the object's real type, or copies would slice it; a polymorphic Object must be final.
+        template <class Object>
+        explicit ClonePtr(UniquePtr<Object>&& pUnique) CI0_NOEXCEPT(true)
+        {
+            static_assert(!std::is_polymorphic<Object>::value || std::is_final<Object>::value,
+                "the cloner is chosen from Object, so adopt only a UniquePtr to the final (concrete) type, not to a base");
+            InitNull();
+            if (pUnique)
+            {
+                attach(pUnique.detach());
+            }
+        }
+
         This& operator=(const This& rhs)
         {
             if (this != &rhs)
             {
-                This other(rhs);
-                Release();
-                InitMove_ImplicitCast(std::move(other));
+                AssignCopy_ImplicitCast(rhs);
             }
             return *this;
         }
@@ -336,9 +992,7 @@ namespace ci0 {
         {
             if (this != &rhs)
             {
-                This other(rhs);
-                Release();
-                InitMove_ImplicitCast(std::move(other));
+                AssignCopy_ImplicitCast(rhs);
             }
             return *this;
         }
@@ -346,9 +1000,7 @@ namespace ci0 {
         {
             if (this != &rhs)
             {
-                This other(rhs);
-                Release();
-                InitMove_ImplicitCast(std::move(other));
+                AssignCopy_ImplicitCast(rhs);
             }
             return *this;
         }
@@ -357,38 +1009,34 @@ namespace ci0 {
             if (this != &rhs)
             {
                 Release();
+                GetAlloc() = rhs.GetAlloc();
                 InitMove_ImplicitCast(std::move(rhs));
             }
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
-            This other(rhs);
-            Release();
-            InitMove_ImplicitCast(std::move(other));
+            AssignCopy_ImplicitCast(rhs);
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(const ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
-            This other(rhs);
-            Release();
-            InitMove_ImplicitCast(std::move(other));
+            AssignCopy_ImplicitCast(rhs);
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
-            This other(rhs);
-            Release();
-            InitMove_ImplicitCast(std::move(other));
+            AssignCopy_ImplicitCast(rhs);
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(ClonePtr<RhsInterface, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
         {
             Release();
+            ClonePtrAllocTraits<Alloc, RhsAlloc>::Propagate(GetAlloc(), rhs.GetAlloc());
             InitMove_ImplicitCast(std::move(rhs));
             return *this;
         }
@@ -398,6 +1046,13 @@ namespace ci0 {
             InitNull();
             return *this;
         }
+        template <class Object>
+        This& operator=(UniquePtr<Object>&& pUnique) CI0_NOEXCEPT(true)
+        {
+            static_assert(!std::is_polymorphic<Object>::value || std::is_final<Object>::value,
+                "the cloner is chosen from Object, so adopt only a UniquePtr to the final (concrete) type, not to a base");
+            return pUnique ? attach(pUnique.detach()) : reset();
+        }
 
         // Copy or move a concrete object in.
         template <class Object>
@@ -426,13 +1081,24 @@ namespace ci0 {
             return *this;
         }
 
+        // Constructs an Object in-place from args, without a temporary.
+        //      pBase.emplace<Derived>(1, 2);
+        template <class Object, class... Args>
+        This& emplace(Args&&... args)
+        {
+            Release();
+            EmplaceObject<Object>(CastImplicit<Object, Interface>(), std::forward<Args>(args)...);
+            return *this;
+        }
+
         // Takes ownership of pObject.  Allows initialization without copying.
         //      ClonePtr<Base> pBase = ClonePtr<Base>().attach(new Derived(...));
         template <class Object>
         This& attach(Object* pObject) CI0_NOEXCEPT(true)
         {
+            static_assert(std::is_same<Alloc, ClonePtrNewDelete>::value, "attach() takes objects from new, which only the default Alloc can free");
             Release();
-            m_pObject = (char*)pObject;
+            SetObjectPtr((char*)pObject);
             m_pInterface = pObject;
             m_pCloner = &ClonePtrCloner<Object>::Instance;
             return *this;
@@ -440,19 +1106,88 @@ namespace ci0 {
         // No detach() in the current design because:
         //  (a) if Interface lacks a public virtual destructor, the caller cannot delete the object
         //  (b) if object resides in SBO, detach() would require a new allocation (no longer noexcept)
-        // This could be revisited though ...
+        // release_to_unique() covers the common case instead.
 
-        // TODO: optimized swap() requires handling all 4 cases of {sbo, !sbo}x{rhsSbo, !rhsSbo}
-        This& swap(This& rhs)
+        // Transfers the object to a UniquePtr.  A heap object changes hands without a copy;
+        // an object in the SBO is moved to a new heap allocation.
+        // note: make sure Interface has a virtual destructor, or that Result is the concrete leaf type
+        template <class Result = Interface>
+        UniquePtr<Result> release_to_unique()
         {
-            std::swap(*this, rhs);
-            return *this;
+            static_assert(std::is_same<Alloc, ClonePtrNewDelete>::value, "release_to_unique() hands the object to delete, which only the default Alloc can free");
+            if (!m_pInterface)
+            {
+                return UniquePtr<Result>();
+            }
+#if !defined(__cpp_aligned_new)
+            // Over-aligned objects come from ClonePtrHeap's aligned allocation, on the heap or when moved out of the SBO,
+            // and UniquePtr cannot free them with delete.
+            assert(m_pCloner->alignofObject <= alignof(std::max_align_t));
+#endif
+            if (!IsObjectInSboBuffer())
+            {
+                Result* pResult = static_cast<Result*>(m_pInterface);
+                InitNull();
+                return UniquePtr<Result>(pResult);
+            }
+
+            // objects in the SBO are always nothrow-move-constructible
+            char* pObject = m_pCloner->pMove(m_sbo, nullptr, 0u, 0u);
+            Result* pResult = static_cast<Result*>((Interface*)(pObject + ((char*)m_pInterface - m_sbo)));
+            Release();
+            InitNull();
+            return UniquePtr<Result>(pResult);
         }
-        This& swap(This&& rhs)
+
+        // Handles all 4 cases of {sbo, !sbo}x{rhsSbo, !rhsSbo}, when the allocators are equal:
+        //  *   heap/heap swaps pointers only
+        //  *   sbo/heap relocates a single object
+        //  *   sbo/sbo relocates through a temporary (3 memcpy's when trivially relocatable)
+        This& swap(This& rhs) CI0_NOEXCEPT(true)
         {
-            std::swap(*this, rhs);
+            if (this == &rhs)
+            {
+                return *this;
+            }
+            if (!GetAlloc().IsEqual(rhs.GetAlloc()))
+            {
+                // neither allocator can free the other's objects, so the allocators are swapped too
+                This tmp(std::move(rhs));
+                rhs = std::move(*this);
+                *this = std::move(tmp);
+                return *this;
+            }
+
+            bool sbo = m_pInterface && IsObjectInSboBuffer();
+            bool rhsSbo = rhs.m_pInterface && rhs.IsObjectInSboBuffer();
+            if (!sbo && !rhsSbo)
+            {
+                char* pObject = ObjectPtr();
+                std::swap(m_pInterface, rhs.m_pInterface);
+                std::swap(m_pCloner, rhs.m_pCloner);
+                SetObjectPtr(rhs.ObjectPtr());
+                rhs.SetObjectPtr(pObject);
+            }
+            else if (!rhsSbo)
+            {
+                SwapSboWithHeap(rhs);
+            }
+            else if (!sbo)
+            {
+                rhs.SwapSboWithHeap(*this);
+            }
+            else
+            {
+                This tmp(std::move(rhs));
+                rhs.InitMove_ImplicitCast(std::move(*this));
+                InitMove_ImplicitCast(std::move(tmp));
+            }
             return *this;
         }
+        This& swap(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            return swap(rhs);
+        }
 
         This& reset() CI0_NOEXCEPT(true)
         {
@@ -467,18 +1202,18 @@ namespace ci0 {
             return attach(pObject);
         }
 
-        template <class RhsInterface, size_t RhsSboSize = sizeof(void*)>
-        ClonePtr<RhsInterface, RhsSboSize> copy_as()
+        template <class RhsInterface, size_t RhsSboSize = sizeof(void*), size_t RhsAlign = ClonePtrDefaultAlign(RhsSboSize), class RhsAlloc = ClonePtrNewDelete>
+        ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> copy_as()
         {
-            ClonePtr<RhsInterface, RhsSboSize> pOther;
+            ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> pOther(std::allocator_arg, ClonePtrAllocTraits<RhsAlloc, Alloc>::SelectOnCopy(GetAlloc()));
             pOther.InitCopy_StaticCast(*this);
             return pOther;
         }
-        template <class RhsInterface, size_t RhsSboSize = sizeof(void*)>
-        ClonePtr<RhsInterface, RhsSboSize> move_as()
+        template <class RhsInterface, size_t RhsSboSize = sizeof(void*), size_t RhsAlign = ClonePtrDefaultAlign(RhsSboSize), class RhsAlloc = ClonePtrNewDelete>
+        ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> move_as()
         {
-            ClonePtr<RhsInterface, RhsSboSize> pOther;
-            pOther.InitMove_StaticCast(*this);
+            ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> pOther(std::allocator_arg, ClonePtrAllocTraits<RhsAlloc, Alloc>::SelectOnMove(GetAlloc()));
+            pOther.InitMove_StaticCast(std::move(*this));
             return pOther;
         }
 
@@ -486,6 +1221,24 @@ namespace ci0 {
         {
             return m_pInterface;
         }
+        const Alloc& get_allocator() const CI0_NOEXCEPT(true)
+        {
+            return GetAlloc();
+        }
+
+        // Exact-type test and cast, by cloner identity: a single pointer comparison, no RTTI.
+        // note: is<Object>() is false for classes derived from Object; use dynamic_cast for those.
+        // note: ClonePtrCloner<Object>::Instance may be duplicated across DLL boundaries, in which case is<>() returns false.
+        template <class Object>
+        bool is() const CI0_NOEXCEPT(true)
+        {
+            return m_pCloner == &ClonePtrCloner<Object>::Instance;
+        }
+        template <class Object>
+        Object* as() const CI0_NOEXCEPT(true)
+        {
+            return is<Object>() ? (Object*)ObjectPtr() : nullptr;
+        }
 
         Interface& operator*() const CI0_NOEXCEPT(true)
         {
@@ -512,13 +1265,13 @@ namespace ci0 {
     };
 
     // Specialization of ClonePtr with SboSize=0.
-    template <class Interface>
-    class ClonePtr<Interface, 0u>
+    template <class Interface, size_t Align, class Alloc>
+    class ClonePtr<Interface, 0u, Align, Alloc> : private Alloc
     {
     public:
-        typedef ClonePtr<Interface, 0u> This;
+        typedef ClonePtr<Interface, 0u, Align, Alloc> This;
 
-        template <class RhsInterface, size_t RhsSboSize>
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
         friend class ClonePtr;
 
     private:
@@ -548,7 +1301,7 @@ namespace ci0 {
         {
             if (m_pInterface)
             {
-                m_pCloner->Destruct(m_pObject, nullptr, 0u);
+                GetAlloc().Delete(m_pCloner, m_pObject);
             }
         }
 
@@ -559,6 +1312,15 @@ namespace ci0 {
             m_pCloner = nullptr;
         }
 
+        Alloc& GetAlloc()
+        {
+            return *this;
+        }
+        const Alloc& GetAlloc() const
+        {
+            return *this;
+        }
+
         // NOTE: InitCopy*() and InitMove*() are written out to produce clear error messages when
         // incompatible types are assigned.
         //
@@ -570,33 +1332,52 @@ namespace ci0 {
         // versus: (clear)
         //      error: assigning to 'Derived *' from incompatible type 'Base *'
 
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitCopy_ImplicitCast(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy_ImplicitCast(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
             InitNull(); // reset members here, in case Copy() throws
             if (!rhs.m_pInterface)
             {
                 return;
             }
-            m_pObject = rhs.m_pCloner->Copy(rhs.m_pObject, nullptr, 0u);
-            m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject));
+            m_pObject = GetAlloc().NewCopy(rhs.m_pCloner, rhs.ObjectPtr());
+            m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.ObjectPtr()));
             m_pCloner = rhs.m_pCloner;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitCopy_StaticCast(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy_StaticCast(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
             InitNull(); // reset members here, in case Copy() throws
             if (!rhs.m_pInterface)
             {
                 return;
             }
-            m_pObject = rhs.m_pCloner->Copy(rhs.m_pObject, nullptr, 0u);
-            m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject)));
+            m_pObject = GetAlloc().NewCopy(rhs.m_pCloner, rhs.ObjectPtr());
+            m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.ObjectPtr())));
             m_pCloner = rhs.m_pCloner;
         }
 
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitMove_ImplicitCast(ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        // Copy-assignment.  When both sides hold the same concrete type and its copy-assignment
+        // cannot throw, the existing object (and its storage) is reused in-place.
+        // Otherwise copy-then-move, for exception safety.
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void AssignCopy_ImplicitCast(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            if (m_pInterface && m_pCloner == rhs.m_pCloner && m_pCloner->isNothrowCopyAssignable)
+            {
+                m_pCloner->CopyAssign(m_pObject, rhs.ObjectPtr());
+                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.ObjectPtr()));
+                return;
+            }
+
+            This other(std::allocator_arg, GetAlloc());
+            other.InitCopy_ImplicitCast(rhs);
+            Release();
+            InitMove_ImplicitCast(std::move(other));
+        }
+
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove_ImplicitCast(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
             if (!rhs.m_pInterface)
             {
@@ -607,8 +1388,21 @@ namespace ci0 {
             if (rhs.IsObjectInSboBuffer())
             {
                 // we cannot steal the object pointer; the move-constructor must be invoked dynamically
-                m_pObject = rhs.m_pCloner->Move(rhs.m_pObject, m_sbo, SboSize);
-                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject));
+                m_pObject = GetAlloc().NewMove(rhs.m_pCloner, rhs.ObjectPtr());
+                rhs.m_pCloner->Destruct(rhs.ObjectPtr(), rhs.SboBuffer(), RhsSboSize);
+                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.ObjectPtr()));
+                m_pCloner = rhs.m_pCloner;
+                rhs.InitNull();
+                return;
+            }
+
+            if (!ClonePtrAllocTraits<Alloc, RhsAlloc>::IsEqual(GetAlloc(), rhs.GetAlloc()))
+            {
+                // rhs's allocator differs from ours; relocate the object instead
+                char* pRhsObject = rhs.ObjectPtr();
+                m_pObject = GetAlloc().NewMove(rhs.m_pCloner, pRhsObject);
+                rhs.GetAlloc().Delete(rhs.m_pCloner, pRhsObject);
+                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - pRhsObject));
                 m_pCloner = rhs.m_pCloner;
                 rhs.InitNull();
                 return;
@@ -616,12 +1410,12 @@ namespace ci0 {
 
             // steal the object pointer
             m_pInterface = rhs.m_pInterface;
-            m_pObject = rhs.m_pObject;
+            m_pObject = rhs.ObjectPtr();
             m_pCloner = rhs.m_pCloner;
             rhs.InitNull();
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        void InitMove_StaticCast(ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove_StaticCast(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
             if (!rhs.m_pInterface)
             {
@@ -632,8 +1426,21 @@ namespace ci0 {
             if (rhs.IsObjectInSboBuffer())
             {
                 // we cannot steal the object pointer; the move-constructor must be invoked dynamically
-                m_pObject = rhs.m_pCloner->Move(rhs.m_pObject, m_sbo, SboSize);
-                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject));
+                m_pObject = GetAlloc().NewMove(rhs.m_pCloner, rhs.ObjectPtr());
+                rhs.m_pCloner->Destruct(rhs.ObjectPtr(), rhs.SboBuffer(), RhsSboSize);
+                m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.ObjectPtr())));
+                m_pCloner = rhs.m_pCloner;
+                rhs.InitNull();
+                return;
+            }
+
+            if (!ClonePtrAllocTraits<Alloc, RhsAlloc>::IsEqual(GetAlloc(), rhs.GetAlloc()))
+            {
+                // rhs's allocator differs from ours; relocate the object instead
+                char* pRhsObject = rhs.ObjectPtr();
+                m_pObject = GetAlloc().NewMove(rhs.m_pCloner, pRhsObject);
+                rhs.GetAlloc().Delete(rhs.m_pCloner, pRhsObject);
+                m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - pRhsObject)));
                 m_pCloner = rhs.m_pCloner;
                 rhs.InitNull();
                 return;
@@ -641,24 +1448,39 @@ namespace ci0 {
 
             // steal the object pointer
             m_pInterface = static_cast<Interface*>(rhs.m_pInterface);
-            m_pObject = rhs.m_pObject;
+            m_pObject = rhs.ObjectPtr();
             m_pCloner = rhs.m_pCloner;
             rhs.InitNull();
         }
 
+        // Constructs an Obj that implements Interface directly in a new allocation.
+        template <class Obj, class CastToInterface, class... Args>
+        void EmplaceObject(CastToInterface&& castToInterface, Args&&... args)
+        {
+            InitNull(); // reset members here, in case the constructor throws
+            Obj* pObject = GetAlloc().template New<Obj>(std::forward<Args>(args)...);
+            m_pInterface = castToInterface(pObject);
+            m_pObject = (char*)pObject;
+            m_pCloner = &ClonePtrCloner<Obj>::Instance;
+        }
+
         // Takes an Object that implements Interface, allocates a second instance of
         // that Object, and either copy or move constructs into the second instance.
         template <class Object, class CastToInterface>
         void AssignObjectValue(Object&& obj, CastToInterface&& castToInterface)
         {
-            InitNull(); // reset members here, in case the constructor throws
             typedef typename std::decay<Object>::type Obj;
-            Obj* pObject = new Obj(std::forward<Object>(obj));
-            m_pInterface = castToInterface(pObject);
-            m_pObject = (char*)pObject;
-            m_pCloner = &ClonePtrCloner<Obj>::Instance;
+            EmplaceObject<Obj>(std::forward<CastToInterface>(castToInterface), std::forward<Object>(obj));
         }
 
+        char* SboBuffer()
+        {
+            return nullptr;
+        }
+        char* ObjectPtr() const
+        {
+            return m_pObject;
+        }
         bool IsObjectInSboBuffer() const
         {
             return false;
@@ -678,40 +1500,56 @@ namespace ci0 {
         {
             InitNull();
         }
+        // Allocates objects that do not fit in the SBO through alloc.
+        //      ClonePtr<Base, 8, 8, ArenaAlloc> pBase(std::allocator_arg, ArenaAlloc(&arena));
+        ClonePtr(std::allocator_arg_t, const Alloc& alloc) CI0_NOEXCEPT(true)
+            : Alloc(alloc)
+        {
+            InitNull();
+        }
 
         ClonePtr(const This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy_ImplicitCast(rhs);
         }
         ClonePtr(const This&& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy_ImplicitCast(rhs);
         }
         ClonePtr(This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy_ImplicitCast(rhs);
         }
         ClonePtr(This&& rhs) CI0_NOEXCEPT(true)
+            : Alloc(rhs.GetAlloc())
         {
             InitMove_ImplicitCast(std::move(rhs));
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy_ImplicitCast(rhs);
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy_ImplicitCast(rhs);
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy_ImplicitCast(rhs);
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        ClonePtr(ClonePtr<RhsInterface, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        // note: moving between different Alloc types relocates the object, which may allocate
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        ClonePtr(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnMove(rhs.GetAlloc()))
         {
             InitMove_ImplicitCast(std::move(rhs));
         }
@@ -723,13 +1561,25 @@ namespace ci0 {
             AssignObjectValue(std::forward<Object>(obj), CastImplicit<Object, Interface>());
         }
 
+        // Takes ownership of pUnique's object, keeping its allocation.  Same requirements as attach().
+        // note: Object must be the object's real type, or copies would slice it; a polymorphic Object must be final.
+        template <class Object>
+        explicit ClonePtr(UniquePtr<Object>&& pUnique) CI0_NOEXCEPT(true)
+        {
+            static_assert(!std::is_polymorphic<Object>::value || std::is_final<Object>::value,
+                "the cloner is chosen from Object, so adopt only a UniquePtr to the final (concrete) type, not to a base");
+            InitNull();
+            if (pUnique)
+            {
+                attach(pUnique.detach());
+            }
+        }
+
         This& operator=(const This& rhs)
         {
             if (this != &rhs)
             {
-                This other(rhs);
-                Release();
-                InitMove_ImplicitCast(std::move(other));
+                AssignCopy_ImplicitCast(rhs);
             }
             return *this;
         }
@@ -737,9 +1587,7 @@ namespace ci0 {
         {
             if (this != &rhs)
             {
-                This other(rhs);
-                Release();
-                InitMove_ImplicitCast(std::move(other));
+                AssignCopy_ImplicitCast(rhs);
             }
             return *this;
         }
@@ -747,9 +1595,7 @@ namespace ci0 {
         {
             if (this != &rhs)
             {
-                This other(rhs);
-                Release();
-                InitMove_ImplicitCast(std::move(other));
+                AssignCopy_ImplicitCast(rhs);
             }
             return *this;
         }
@@ -758,38 +1604,34 @@ namespace ci0 {
             if (this != &rhs)
             {
                 Release();
+                GetAlloc() = rhs.GetAlloc();
                 InitMove_ImplicitCast(std::move(rhs));
             }
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(const ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
-            This other(rhs);
-            Release();
-            InitMove_ImplicitCast(std::move(other));
+            AssignCopy_ImplicitCast(rhs);
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(const ClonePtr<RhsInterface, RhsSboSize>&& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
-            This other(rhs);
-            Release();
-            InitMove_ImplicitCast(std::move(other));
+            AssignCopy_ImplicitCast(rhs);
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(ClonePtr<RhsInterface, RhsSboSize>& rhs)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
-            This other(rhs);
-            Release();
-            InitMove_ImplicitCast(std::move(other));
+            AssignCopy_ImplicitCast(rhs);
             return *this;
         }
-        template <class RhsInterface, size_t RhsSboSize>
-        This& operator=(ClonePtr<RhsInterface, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
         {
             Release();
+            ClonePtrAllocTraits<Alloc, RhsAlloc>::Propagate(GetAlloc(), rhs.GetAlloc());
             InitMove_ImplicitCast(std::move(rhs));
             return *this;
         }
@@ -799,6 +1641,13 @@ namespace ci0 {
             InitNull();
             return *this;
         }
+        template <class Object>
+        This& operator=(UniquePtr<Object>&& pUnique) CI0_NOEXCEPT(true)
+        {
+            static_assert(!std::is_polymorphic<Object>::value || std::is_final<Object>::value,
+                "the cloner is chosen from Object, so adopt only a UniquePtr to the final (concrete) type, not to a base");
+            return pUnique ? attach(pUnique.detach()) : reset();
+        }
 
         // Copy or move a concrete object in.
         template <class Object>
@@ -827,11 +1676,22 @@ namespace ci0 {
             return *this;
         }
 
+        // Constructs an Object in-place from args, without a temporary.
+        //      pBase.emplace<Derived>(1, 2);
+        template <class Object, class... Args>
+        This& emplace(Args&&... args)
+        {
+            Release();
+            EmplaceObject<Object>(CastImplicit<Object, Interface>(), std::forward<Args>(args)...);
+            return *this;
+        }
+
         // Takes ownership of pObject.  Allows initialization without copying.
         //      ClonePtr<Base> pBase = ClonePtr<Base>().attach(new Derived(...));
         template <class Object>
         This& attach(Object* pObject) CI0_NOEXCEPT(true)
         {
+            static_assert(std::is_same<Alloc, ClonePtrNewDelete>::value, "attach() takes objects from new, which only the default Alloc can free");
             Release();
             m_pObject = (char*)pObject;
             m_pInterface = pObject;
@@ -843,20 +1703,34 @@ namespace ci0 {
         template <class Result = Interface>
         Result* detach() CI0_NOEXCEPT(true)
         {
+            static_assert(std::is_same<Alloc, ClonePtrNewDelete>::value, "detach() hands the object to delete, which only the default Alloc can free");
             Result* pResult = static_cast<Result*>(m_pInterface);
             InitNull();
             return pResult;
         }
+        // Transfers the object to a UniquePtr, without a copy.
+        // note: make sure Interface has a virtual destructor, or that Result is the concrete leaf type
+        template <class Result = Interface>
+        UniquePtr<Result> release_to_unique() CI0_NOEXCEPT(true)
+        {
+#if !defined(__cpp_aligned_new)
+            assert(!m_pCloner || m_pCloner->alignofObject <= alignof(std::max_align_t)); // over-aligned objects are not allocated with new
+#endif
+            return UniquePtr<Result>(detach<Result>());
+        }
 
+        // Objects always live on the heap, so only the pointers (and allocators) are swapped.
         This& swap(This& rhs) CI0_NOEXCEPT(true)
         {
-            std::swap(*this, rhs);
+            std::swap(GetAlloc(), rhs.GetAlloc());
+            std::swap(m_pInterface, rhs.m_pInterface);
+            std::swap(m_pObject, rhs.m_pObject);
+            std::swap(m_pCloner, rhs.m_pCloner);
             return *this;
         }
         This& swap(This&& rhs) CI0_NOEXCEPT(true)
         {
-            std::swap(*this, rhs);
-            return *this;
+            return swap(rhs);
         }
 
         This& reset() CI0_NOEXCEPT(true)
@@ -872,18 +1746,18 @@ namespace ci0 {
             return attach(pObject);
         }
 
-        template <class RhsInterface, size_t RhsSboSize = sizeof(void*)>
-        ClonePtr<RhsInterface, RhsSboSize> copy_as()
+        template <class RhsInterface, size_t RhsSboSize = sizeof(void*), size_t RhsAlign = ClonePtrDefaultAlign(RhsSboSize), class RhsAlloc = ClonePtrNewDelete>
+        ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> copy_as()
         {
-            ClonePtr<RhsInterface, RhsSboSize> pOther;
+            ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> pOther(std::allocator_arg, ClonePtrAllocTraits<RhsAlloc, Alloc>::SelectOnCopy(GetAlloc()));
             pOther.InitCopy_StaticCast(*this);
             return pOther;
         }
-        template <class RhsInterface, size_t RhsSboSize = sizeof(void*)>
-        ClonePtr<RhsInterface, RhsSboSize> move_as() CI0_NOEXCEPT(true)
+        template <class RhsInterface, size_t RhsSboSize = sizeof(void*), size_t RhsAlign = ClonePtrDefaultAlign(RhsSboSize), class RhsAlloc = ClonePtrNewDelete>
+        ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> move_as() CI0_NOEXCEPT(true)
         {
-            ClonePtr<RhsInterface, RhsSboSize> pOther;
-            pOther.InitMove_StaticCast(*this);
+            ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> pOther(std::allocator_arg, ClonePtrAllocTraits<RhsAlloc, Alloc>::SelectOnMove(GetAlloc()));
+            pOther.InitMove_StaticCast(std::move(*this));
             return pOther;
         }
 
@@ -891,6 +1765,24 @@ namespace ci0 {
         {
             return m_pInterface;
         }
+        const Alloc& get_allocator() const CI0_NOEXCEPT(true)
+        {
+            return GetAlloc();
+        }
+
+        // Exact-type test and cast, by cloner identity: a single pointer comparison, no RTTI.
+        // note: is<Object>() is false for classes derived from Object; use dynamic_cast for those.
+        // note: ClonePtrCloner<Object>::Instance may be duplicated across DLL boundaries, in which case is<>() returns false.
+        template <class Object>
+        bool is() const CI0_NOEXCEPT(true)
+        {
+            return m_pCloner == &ClonePtrCloner<Object>::Instance;
+        }
+        template <class Object>
+        Object* as() const CI0_NOEXCEPT(true)
+        {
+            return is<Object>() ? (Object*)ObjectPtr() : nullptr;
+        }
 
         Interface& operator*() const CI0_NOEXCEPT(true)
         {
@@ -916,63 +1808,83 @@ namespace ci0 {
         }
     };
 
-    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
-    inline bool operator==(const ClonePtr<LhsObject, LhsSboSize>& lhs, const ClonePtr<RhsObject, RhsSboSize>& rhs)
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class LhsAlloc, class RhsObject, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+    inline bool operator==(const ClonePtr<LhsObject, LhsSboSize, LhsAlign, LhsAlloc>& lhs, const ClonePtr<RhsObject, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
     {
         return lhs.get() == rhs.get();
     }
-    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
-    inline bool operator!=(const ClonePtr<LhsObject, LhsSboSize>& lhs, const ClonePtr<RhsObject, RhsSboSize>& rhs)
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class LhsAlloc, class RhsObject, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+    inline bool operator!=(const ClonePtr<LhsObject, LhsSboSize, LhsAlign, LhsAlloc>& lhs, const ClonePtr<RhsObject, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
     {
         return lhs.get() != rhs.get();
     }
-    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
-    inline bool operator>=(const ClonePtr<LhsObject, LhsSboSize>& lhs, const ClonePtr<RhsObject, RhsSboSize>& rhs)
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class LhsAlloc, class RhsObject, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+    inline bool operator>=(const ClonePtr<LhsObject, LhsSboSize, LhsAlign, LhsAlloc>& lhs, const ClonePtr<RhsObject, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
     {
         return lhs.get() >= rhs.get();
     }
-    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
-    inline bool operator<=(const ClonePtr<LhsObject, LhsSboSize>& lhs, const ClonePtr<RhsObject, RhsSboSize>& rhs)
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class LhsAlloc, class RhsObject, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+    inline bool operator<=(const ClonePtr<LhsObject, LhsSboSize, LhsAlign, LhsAlloc>& lhs, const ClonePtr<RhsObject, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
     {
         return lhs.get() <= rhs.get();
     }
-    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
-    inline bool operator>(const ClonePtr<LhsObject, LhsSboSize>& lhs, const ClonePtr<RhsObject, RhsSboSize>& rhs)
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class LhsAlloc, class RhsObject, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+    inline bool operator>(const ClonePtr<LhsObject, LhsSboSize, LhsAlign, LhsAlloc>& lhs, const ClonePtr<RhsObject, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
     {
         return lhs.get() > rhs.get();
     }
-    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
-    inline bool operator<(const ClonePtr<LhsObject, LhsSboSize>& lhs, const ClonePtr<RhsObject, RhsSboSize>& rhs)
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class LhsAlloc, class RhsObject, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+    inline bool operator<(const ClonePtr<LhsObject, LhsSboSize, LhsAlign, LhsAlloc>& lhs, const ClonePtr<RhsObject, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
     {
         return lhs.get() < rhs.get();
     }
 
-    template <class Object, size_t SboSize>
-    inline bool operator==(const ClonePtr<Object, SboSize>& lhs, std::nullptr_t)
+    template <class Object, size_t SboSize, size_t Align, class Alloc>
+    inline bool operator==(const ClonePtr<Object, SboSize, Align, Alloc>& lhs, std::nullptr_t)
     {
         return lhs.get() == nullptr;
     }
-    template <class Object, size_t SboSize>
-    inline bool operator==(std::nullptr_t, const ClonePtr<Object, SboSize>& rhs)
+    template <class Object, size_t SboSize, size_t Align, class Alloc>
+    inline bool operator==(std::nullptr_t, const ClonePtr<Object, SboSize, Align, Alloc>& rhs)
     {
         return nullptr == rhs.get();
     }
-    template <class Object, size_t SboSize>
-    inline bool operator!=(const ClonePtr<Object, SboSize>& lhs, std::nullptr_t)
+    template <class Object, size_t SboSize, size_t Align, class Alloc>
+    inline bool operator!=(const ClonePtr<Object, SboSize, Align, Alloc>& lhs, std::nullptr_t)
     {
         return lhs.get() != nullptr;
     }
-    template <class Object, size_t SboSize>
-    inline bool operator!=(std::nullptr_t, const ClonePtr<Object, SboSize>& rhs)
+    template <class Object, size_t SboSize, size_t Align, class Alloc>
+    inline bool operator!=(std::nullptr_t, const ClonePtr<Object, SboSize, Align, Alloc>& rhs)
     {
         return nullptr != rhs.get();
     }
 
-    template <class Object, size_t SboSize>
-    void swap(ClonePtr<Object, SboSize>& lhs, ClonePtr<Object, SboSize>& rhs)
+    template <class Object, size_t SboSize, size_t Align, class Alloc>
+    void swap(ClonePtr<Object, SboSize, Align, Alloc>& lhs, ClonePtr<Object, SboSize, Align, Alloc>& rhs)
     {
         lhs.swap(rhs);
     }
+
+    // Constructs an Object in-place inside a new ClonePtr.
+    //      ClonePtr<Base> pBase = MakeClone<Base, Derived>(1, 2);
+    template <class Interface, class Object, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize), class... Args>
+    ClonePtr<Interface, SboSize, Align> MakeClone(Args&&... args)
+    {
+        ClonePtr<Interface, SboSize, Align> pResult;
+        pResult.template emplace<Object>(std::forward<Args>(args)...);
+        return pResult;
+    }
+
+    // Same as MakeClone, with an allocator for objects that do not fit in the SBO.
+    //      ClonePtr<Base, 8, 8, ArenaAlloc> pBase = AllocateClone<Base, Derived, 8, 8>(ArenaAlloc(&arena), 1, 2);
+    template <class Interface, class Object, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize), class Alloc, class... Args>
+    ClonePtr<Interface, SboSize, Align, Alloc> AllocateClone(const Alloc& alloc, Args&&... args)
+    {
+        ClonePtr<Interface, SboSize, Align, Alloc> pResult(std::allocator_arg, alloc);
+        pResult.template emplace<Object>(std::forward<Args>(args)...);
+        return pResult;
+    }
 }
 
 #if _MSC_VER
@@ -0,0 +1,317 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <cstddef>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Noexcept.h"
+#include "ClonePtr.h"
+
+namespace ci0 {
+
+    // Size-class pool for small heap-fallback objects, in blocks of 16, 32, 64, 128 and 256 bytes.
+    //
+    // Each thread allocates from its own cache, with no locks or atomics on the fast path.
+    // Blocks are carved from 64KB chunks that belong to one cache; a block freed by another thread is pushed
+    // onto its owner's lock-free return list, which the owner takes back whenever its own free list runs dry.
+    // A cache outlives its thread: on thread exit it is parked, and adopted by the next thread that allocates.
+    // Memory is recycled within the pool but never returned to the system.
+    class ClonePtrPool
+    {
+    public:
+        static const size_t MinBlockSize = 16;
+        static const size_t MaxBlockSize = 256;
+        static const size_t NumSizeClasses = 5;
+        static const size_t ChunkSize = 64 * 1024;
+
+        // True if an object of this size is allocated from the pool.
+        // Blocks are aligned to their size, and alignof(Object) <= sizeof(Object), so any such object fits.
+        static bool Fits(size_t size)
+        {
+            return size <= MaxBlockSize;
+        }
+
+        static void* Allocate(size_t size)
+        {
+            assert(size > 0 && Fits(size));
+            size_t sizeClass = SizeClassOf(size);
+            Cache* pCache = ThreadCache();
+            if (!pCache)
+            {
+                // this thread is exiting; borrow a parked cache
+                pCache = Unpark();
+                void* p = AllocateFrom(pCache, sizeClass);
+                Park(pCache);
+                return p;
+            }
+            return AllocateFrom(pCache, sizeClass);
+        }
+
+        // size must be the size that was passed to Allocate().
+        static void Deallocate(void* p, size_t size)
+        {
+            size_t sizeClass = SizeClassOf(size);
+            Block* pBlock = (Block*)p;
+            Cache* pOwner = ((ChunkHeader*)(uintptr_t(p) & ~uintptr_t(ChunkSize - 1)))->pOwner;
+            if (pOwner == ThreadCachePtr())
+            {
+                pBlock->pNext = pOwner->pFree[sizeClass];
+                pOwner->pFree[sizeClass] = pBlock;
+                return;
+            }
+
+            // another thread's block; only the owner pops, and it takes the whole list at once, so pushes are ABA-safe
+            Block* pHead = pOwner->pReturned[sizeClass].load(std::memory_order_relaxed);
+            do
+            {
+                pBlock->pNext = pHead;
+            } while (!pOwner->pReturned[sizeClass].compare_exchange_weak(pHead, pBlock, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+    private:
+        struct Block
+        {
+            Block* pNext;
+        };
+
+        struct Cache
+        {
+            Block* pFree[NumSizeClasses];
+            char* pCarve[NumSizeClasses];
+            char* pCarveEnd[NumSizeClasses];
+            std::atomic<Block*> pReturned[NumSizeClasses];
+            Cache* pNextParked;
+
+            Cache()
+                : pNextParked(nullptr)
+            {
+                for (size_t i = 0; i < NumSizeClasses; ++i)
+                {
+                    pFree[i] = nullptr;
+                    pCarve[i] = nullptr;
+                    pCarveEnd[i] = nullptr;
+                    pReturned[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        // Placed at the start of each chunk, so that any block can find its owner by masking its address.
+        // Blocks start after MaxBlockSize bytes, which keeps every block aligned to its size.
+        struct ChunkHeader
+        {
+            Cache* pOwner;
+        };
+
+        struct ThreadCacheOwner
+        {
+            Cache* pCache;
+
+            ~ThreadCacheOwner()
+            {
+                ThreadCachePtr() = nullptr;
+                ThreadExited() = true;
+                Park(pCache);
+            }
+        };
+
+        // 1..16 -> 0, 17..32 -> 1, 33..64 -> 2, 65..128 -> 3, 129..256 -> 4
+        static size_t SizeClassOf(size_t size)
+        {
+            static const uint8_t s_sizeClassBy16[16] = { 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+            return s_sizeClassBy16[(size - 1) / 16];
+        }
+
+        static void* AllocateFrom(Cache* pCache, size_t sizeClass)
+        {
+            Block* pBlock = pCache->pFree[sizeClass];
+            if (!pBlock)
+            {
+                pBlock = pCache->pReturned[sizeClass].exchange(nullptr, std::memory_order_acquire);
+                if (!pBlock)
+                {
+                    return Carve(pCache, sizeClass);
+                }
+            }
+            pCache->pFree[sizeClass] = pBlock->pNext;
+            return pBlock;
+        }
+
+        static void* Carve(Cache* pCache, size_t sizeClass)
+        {
+            if (pCache->pCarve[sizeClass] == pCache->pCarveEnd[sizeClass])
+            {
+                char* pChunk = AllocateChunk();
+                ((ChunkHeader*)pChunk)->pOwner = pCache;
+                pCache->pCarve[sizeClass] = pChunk + MaxBlockSize;
+                pCache->pCarveEnd[sizeClass] = pChunk + ChunkSize;
+            }
+            void* p = pCache->pCarve[sizeClass];
+            pCache->pCarve[sizeClass] += MinBlockSize << sizeClass;
+            return p;
+        }
+
+        static char* AllocateChunk()
+        {
+            void* pMem = nullptr;
+#if _MSC_VER
+            pMem = _aligned_malloc(ChunkSize, ChunkSize);
+#else
+            if (posix_memalign(&pMem, ChunkSize, ChunkSize))
+            {
+                pMem = nullptr;
+            }
+#endif
+            if (!pMem)
+            {
+                throw std::bad_alloc();
+            }
+            return (char*)pMem;
+        }
+
+        // note: these thread_locals are trivially destructible, so they stay usable while other
+        // thread_locals (e.g. ClonePtrs) are destroyed at thread exit.
+        static Cache*& ThreadCachePtr()
+        {
+            static thread_local Cache* t_pCache = nullptr;
+            return t_pCache;
+        }
+        static bool& ThreadExited()
+        {
+            static thread_local bool t_exited = false;
+            return t_exited;
+        }
+        static Cache* ThreadCache()
+        {
+            Cache* pCache = ThreadCachePtr();
+            return pCache ? pCache : InitThreadCache();
+        }
+        static Cache* InitThreadCache()
+        {
+            if (ThreadExited())
+            {
+                return nullptr;
+            }
+            static thread_local ThreadCacheOwner t_owner = { Unpark() };
+            ThreadCachePtr() = t_owner.pCache;
+            return t_owner.pCache;
+        }
+
+        // Parked caches are kept in a spinlock-protected stack.  Both are constant-initialized and never destroyed,
+        // so threads may park their caches at any point during shutdown.
+        static std::atomic_flag& ParkingLock()
+        {
+            static std::atomic_flag s_lock = ATOMIC_FLAG_INIT;
+            return s_lock;
+        }
+        static Cache*& ParkedCaches()
+        {
+            static Cache* s_pParked = nullptr;
+            return s_pParked;
+        }
+        static void Park(Cache* pCache)
+        {
+            while (ParkingLock().test_and_set(std::memory_order_acquire))
+            {
+            }
+            pCache->pNextParked = ParkedCaches();
+            ParkedCaches() = pCache;
+            ParkingLock().clear(std::memory_order_release);
+        }
+        static Cache* Unpark()
+        {
+            while (ParkingLock().test_and_set(std::memory_order_acquire))
+            {
+            }
+            Cache* pCache = ParkedCaches();
+            if (pCache)
+            {
+                ParkedCaches() = pCache->pNextParked;
+            }
+            ParkingLock().clear(std::memory_order_release);
+            return pCache ? pCache : new Cache();
+        }
+    };
+
+    // Allocation policy (see ClonePtrNewDelete) that takes heap-fallback objects of up to
+    // ClonePtrPool::MaxBlockSize bytes from ClonePtrPool, and larger ones from the global operator new.
+    //      ClonePtr<IStrategy, sizeof(void*), alignof(void*), ClonePtrPoolAllocator> pStrategy;
+    //      Function<void(int), sizeof(void*), alignof(std::max_align_t), ClonePtrPoolAllocator> callback;
+    struct ClonePtrPoolAllocator
+    {
+        template <class Object, class... Args>
+        Object* New(Args&&... args) const
+        {
+            if (!ClonePtrPool::Fits(sizeof(Object)))
+            {
+                return ClonePtrHeap<Object>::New(std::forward<Args>(args)...);
+            }
+            void* pMem = ClonePtrPool::Allocate(sizeof(Object));
+            try
+            {
+                return new (pMem) Object(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                ClonePtrPool::Deallocate(pMem, sizeof(Object));
+                throw;
+            }
+        }
+        char* NewCopy(const IClonePtrCloner* pCloner, const char* pRhsObj) const
+        {
+            if (!ClonePtrPool::Fits(pCloner->sizeofObject))
+            {
+                return pCloner->pCopy(pRhsObj, nullptr, 0u, 0u);
+            }
+            char* pMem = (char*)ClonePtrPool::Allocate(pCloner->sizeofObject);
+            try
+            {
+                pCloner->pCopyConstruct(pRhsObj, pMem);
+            }
+            catch (...)
+            {
+                ClonePtrPool::Deallocate(pMem, pCloner->sizeofObject);
+                throw;
+            }
+            return pMem;
+        }
+        char* NewMove(const IClonePtrCloner* pCloner, char* pRhsObj) const
+        {
+            if (!pCloner->isNothrowMoveConstructible)
+            {
+                return NewCopy(pCloner, pRhsObj);
+            }
+            if (!ClonePtrPool::Fits(pCloner->sizeofObject))
+            {
+                return pCloner->pMove(pRhsObj, nullptr, 0u, 0u);
+            }
+            char* pMem = (char*)ClonePtrPool::Allocate(pCloner->sizeofObject);
+            pCloner->pMoveConstruct(pRhsObj, pMem);
+            return pMem;
+        }
+        void Delete(const IClonePtrMover* pMover, char* pObj) const
+        {
+            if (!ClonePtrPool::Fits(pMover->sizeofObject))
+            {
+                pMover->pDelete(pObj);
+                return;
+            }
+            if (!pMover->isTriviallyDestructible)
+            {
+                pMover->pDestroyInPlace(pObj);
+            }
+            ClonePtrPool::Deallocate(pObj, pMover->sizeofObject);
+        }
+        ClonePtrPoolAllocator SelectOnCopy() const
+        {
+            return *this;
+        }
+        bool IsEqual(const ClonePtrPoolAllocator&) const
+        {
+            return true;
+        }
+    };
+}
@@ -0,0 +1,463 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <cstddef>
+#include <algorithm>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Noexcept.h"
+#include "ClonePtr.h"
+
+#if _MSC_VER
+#pragma warning(push)
+#pragma warning (disable : 4521) // "multiple copy constructors specified"
+#pragma warning (disable : 4522) // "multiple assignment operators specified"
+#endif
+
+namespace ci0 {
+
+    // ClosedPolyPtr is a ClonePtr restricted to a closed set of implementations Impls...
+    // Instead of a cloner pointer it stores a 1-byte type index, and copy/move/destroy dispatch on that
+    // index through a switch that the compiler can lower to a jump table and inline into.
+    // visit() calls a function object with the concrete Impl&, so calls made on it are resolved
+    // statically (mark the Impls 'final' to let the compiler devirtualize calls to their virtual methods).
+    //
+    //      typedef ClosedPolyPtr<ICodec, 16, RawCodec, RleCodec, LzCodec> CodecPtr;
+    //      CodecPtr pCodec = CodecPtr(RleCodec());
+    //      size_t n = pCodec.visit([&](auto& codec) { return codec.Encode(src, dst); });
+    //
+    // Impls that fit in SboSize are stored inline; others are heap-allocated.  The choice is made at compile time.
+    template <class Interface, size_t SboSize, class... Impls>
+    class ClosedPolyPtr
+    {
+    public:
+        typedef ClosedPolyPtr<Interface, SboSize, Impls...> This;
+
+        static_assert(sizeof...(Impls) > 0, "ClosedPolyPtr requires at least one implementation");
+        static_assert(sizeof...(Impls) < 255, "ClosedPolyPtr supports at most 254 implementations");
+
+    private:
+        static const size_t Align = ClonePtrDefaultAlign(SboSize);
+        static const size_t SboStorageSize = (SboSize < sizeof(char*)) ? sizeof(char*) : SboSize;
+        static const size_t SboStorageAlign = (Align < alignof(char*)) ? alignof(char*) : Align;
+
+        template <class Object>
+        struct FitsInSbo : std::integral_constant<bool,
+            std::is_nothrow_move_constructible<Object>::value && sizeof(Object) <= SboSize && alignof(Object) <= Align>
+        {
+        };
+
+        // IndexOf<Object, Impls...>::value is 1 + the position of Object in Impls..., or 0 if absent.
+        template <class Object, class... List>
+        struct IndexOf : std::integral_constant<uint8_t, 0>
+        {
+        };
+        template <class Object, class First, class... Rest>
+        struct IndexOf<Object, First, Rest...> : std::integral_constant<uint8_t,
+            std::is_same<Object, First>::value ? 1 : (IndexOf<Object, Rest...>::value ? 1 + IndexOf<Object, Rest...>::value : 0)>
+        {
+        };
+
+        // Calls fn(Impl&) for the Impl at position index-1, through an if-chain on constants
+        // (which compilers turn into a jump table, with each case inlined).
+        template <uint8_t Index, class... List>
+        struct Dispatcher;
+        template <uint8_t Index, class Impl>
+        struct Dispatcher<Index, Impl>
+        {
+            template <class Ret, class Cv, class Fn>
+            static Ret Invoke(uint8_t index, char* pSbo, Fn& fn)
+            {
+                assert(index == Index);
+                (void)index;
+                typedef typename std::conditional<std::is_const<Cv>::value, const Impl, Impl>::type CvImpl;
+                return fn(*This::template ObjectPtr<Impl>(pSbo), (CvImpl*)nullptr);
+            }
+        };
+        template <uint8_t Index, class Impl, class Next, class... Rest>
+        struct Dispatcher<Index, Impl, Next, Rest...>
+        {
+            template <class Ret, class Cv, class Fn>
+            static Ret Invoke(uint8_t index, char* pSbo, Fn& fn)
+            {
+                if (index == Index)
+                {
+                    return Dispatcher<Index, Impl>::template Invoke<Ret, Cv>(index, pSbo, fn);
+                }
+                return Dispatcher<Index + 1, Next, Rest...>::template Invoke<Ret, Cv>(index, pSbo, fn);
+            }
+        };
+
+        // Adapts a visit() function object to the Dispatcher calling convention.
+        template <class Fn>
+        struct VisitOp
+        {
+            Fn& fn;
+            template <class Impl, class CvImpl>
+            auto operator()(Impl& obj, CvImpl*) -> decltype(std::declval<Fn&>()(std::declval<CvImpl&>()))
+            {
+                return fn(static_cast<CvImpl&>(obj));
+            }
+        };
+        struct DestroyOp
+        {
+            template <class Impl, class CvImpl>
+            void operator()(Impl& obj, CvImpl*)
+            {
+                if (FitsInSbo<Impl>::value)
+                {
+                    obj.~Impl();
+                }
+                else
+                {
+                    ClonePtrHeap<Impl>::Delete(&obj);
+                }
+            }
+        };
+        struct CopyOp
+        {
+            This& dst;
+            template <class Impl, class CvImpl>
+            void operator()(Impl& obj, CvImpl*)
+            {
+                dst.template EmplaceObject<Impl>(static_cast<const Impl&>(obj));
+            }
+        };
+        // Only called for Impls in the SBO; heap Impls are moved by stealing the pointer.
+        struct MoveOp
+        {
+            This& dst;
+            template <class Impl, class CvImpl>
+            void operator()(Impl& obj, CvImpl*)
+            {
+                MoveImpl(obj, FitsInSbo<Impl>());
+            }
+            template <class Impl>
+            void MoveImpl(Impl& obj, std::true_type)
+            {
+                Impl* pObject = new (dst.m_sbo) Impl(std::move(obj));
+                dst.m_pInterface = pObject;
+                obj.~Impl();
+            }
+            template <class Impl>
+            void MoveImpl(Impl&, std::false_type)
+            {
+                // never called
+                assert(false);
+            }
+        };
+
+    private:
+        Interface* m_pInterface;
+        alignas(SboStorageAlign) char m_sbo[SboStorageSize];
+        // 0 when null; otherwise 1 + the position of the object's type in Impls...
+        uint8_t m_index;
+
+    private:
+        // prevent naked delete from compiling; http://stackoverflow.com/a/3312507
+        struct PreventDelete;
+        operator PreventDelete*() const;
+
+    private:
+        template <class Impl>
+        static Impl* ObjectPtr(char* pSbo)
+        {
+            return FitsInSbo<Impl>::value ? (Impl*)pSbo : *(Impl**)pSbo;
+        }
+
+        template <class Ret, class Cv, class Fn>
+        Ret Dispatch(Fn& fn) const
+        {
+            return Dispatcher<1, Impls...>::template Invoke<Ret, Cv>(m_index, (char*)m_sbo, fn);
+        }
+
+        // NOTE: Release() leaves members pointing at a destructed object.
+        // Callers must subsequently call some Init*() function (except in ~ClosedPolyPtr).
+        void Release()
+        {
+            if (m_index)
+            {
+                DestroyOp op;
+                Dispatch<void, This>(op);
+            }
+        }
+
+        void InitNull()
+        {
+            m_pInterface = nullptr;
+            m_index = 0;
+        }
+
+        void InitCopy(const This& rhs)
+        {
+            InitNull(); // reset members here, in case the copy throws
+            if (rhs.m_index)
+            {
+                CopyOp op = { *this };
+                rhs.Dispatch<void, const This>(op);
+            }
+        }
+
+        void InitMove(This&& rhs)
+        {
+            if (!rhs.m_index)
+            {
+                InitNull();
+                return;
+            }
+            if (uintptr_t((char*)rhs.m_pInterface - rhs.m_sbo) < SboSize)
+            {
+                MoveOp op = { *this };
+                rhs.Dispatch<void, This>(op);
+            }
+            else
+            {
+                // steal the object pointer
+                m_pInterface = rhs.m_pInterface;
+                memcpy(m_sbo, rhs.m_sbo, sizeof(char*));
+            }
+            m_index = rhs.m_index;
+            rhs.InitNull();
+        }
+
+#if defined(__GNUC__)
+// Silence a spurious warning that an object is being placement-new'd into a too-small buffer; see ClonePtr.h.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wplacement-new"
+#endif
+        template <class Object, class... Args>
+        void EmplaceObject(Args&&... args)
+        {
+            static_assert(IndexOf<Object, Impls...>::value != 0, "Object is not one of the ClosedPolyPtr's Impls");
+            InitNull(); // reset members here, in case the constructor throws
+            Object* pObject;
+            if (FitsInSbo<Object>::value)
+            {
+                pObject = new (m_sbo) Object(std::forward<Args>(args)...);
+            }
+            else
+            {
+                pObject = ClonePtrHeap<Object>::New(std::forward<Args>(args)...);
+                new (m_sbo) Object*(pObject);
+            }
+            m_pInterface = pObject;
+            m_index = IndexOf<Object, Impls...>::value;
+        }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+    public:
+        ~ClosedPolyPtr() CI0_NOEXCEPT(true)
+        {
+            Release();
+        }
+
+        ClosedPolyPtr() CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        ClosedPolyPtr(nullptr_t) CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+
+        ClosedPolyPtr(const This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        ClosedPolyPtr(const This&& rhs)
+        {
+            InitCopy(rhs);
+        }
+        ClosedPolyPtr(This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        ClosedPolyPtr(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove(std::move(rhs));
+        }
+
+        // Copy or move a concrete object in.
+        template <class Object>
+        explicit ClosedPolyPtr(Object&& obj)
+        {
+            EmplaceObject<typename std::decay<Object>::type>(std::forward<Object>(obj));
+        }
+
+        This& operator=(const This& rhs)
+        {
+            if (this != &rhs)
+            {
+                This other(rhs);
+                Release();
+                InitMove(std::move(other));
+            }
+            return *this;
+        }
+        This& operator=(const This&& rhs)
+        {
+            return *this = static_cast<const This&>(rhs);
+        }
+        This& operator=(This& rhs)
+        {
+            return *this = static_cast<const This&>(rhs);
+        }
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitMove(std::move(rhs));
+            }
+            return *this;
+        }
+        This& operator=(nullptr_t) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitNull();
+            return *this;
+        }
+
+        // Copy or move a concrete object in.
+        // note: the new object is built before the old one is released, so obj may be (or be owned by) the current object,
+        // and *this is unchanged if construction throws.
+        template <class Object>
+        This& assign(Object&& obj)
+        {
+            This other;
+            other.EmplaceObject<typename std::decay<Object>::type>(std::forward<Object>(obj));
+            Release();
+            InitMove(std::move(other));
+            return *this;
+        }
+
+        // Constructs an Object from args, then moves it in (as assign(); an SBO Object is moved once).
+        template <class Object, class... Args>
+        This& emplace(Args&&... args)
+        {
+            This other;
+            other.EmplaceObject<Object>(std::forward<Args>(args)...);
+            Release();
+            InitMove(std::move(other));
+            return *this;
+        }
+
+        This& swap(This& rhs) CI0_NOEXCEPT(true)
+        {
+            if (this != &rhs)
+            {
+                This tmp(std::move(rhs));
+                rhs.InitMove(std::move(*this));
+                InitMove(std::move(tmp));
+            }
+            return *this;
+        }
+        This& swap(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            return swap(rhs);
+        }
+
+        This& reset() CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitNull();
+            return *this;
+        }
+
+        // Calls fn(Impl&) with the object's concrete type; every Impl's call must return the same type.
+        // Precondition: not null.
+        template <class Fn>
+        auto visit(Fn&& fn) -> decltype(fn(std::declval<typename std::tuple_element<0, std::tuple<Impls...>>::type&>()))
+        {
+            typedef decltype(fn(std::declval<typename std::tuple_element<0, std::tuple<Impls...>>::type&>())) Ret;
+            assert(m_index);
+            VisitOp<Fn> op = { fn };
+            return Dispatch<Ret, This>(op);
+        }
+        template <class Fn>
+        auto visit(Fn&& fn) const -> decltype(fn(std::declval<const typename std::tuple_element<0, std::tuple<Impls...>>::type&>()))
+        {
+            typedef decltype(fn(std::declval<const typename std::tuple_element<0, std::tuple<Impls...>>::type&>())) Ret;
+            assert(m_index);
+            VisitOp<Fn> op = { fn };
+            return Dispatch<Ret, const This>(op);
+        }
+
+        // Exact-type test and cast, by type index.
+        template <class Object>
+        bool is() const CI0_NOEXCEPT(true)
+        {
+            return m_index && m_index == IndexOf<Object, Impls...>::value;
+        }
+        template <class Object>
+        Object* as() const CI0_NOEXCEPT(true)
+        {
+            return is<Object>() ? ObjectPtr<Object>((char*)m_sbo) : nullptr;
+        }
+
+        Interface* const& get() const CI0_NOEXCEPT(true)
+        {
+            return m_pInterface;
+        }
+
+        Interface& operator*() const CI0_NOEXCEPT(true)
+        {
+            return *m_pInterface;
+        }
+        Interface* operator->() const CI0_NOEXCEPT(true)
+        {
+            return m_pInterface;
+        }
+
+        operator Interface*() const CI0_NOEXCEPT(true)
+        {
+            return m_pInterface;
+        }
+        explicit operator bool() const CI0_NOEXCEPT(true)
+        {
+            return !!m_pInterface;
+        }
+        template <class Type>
+        explicit operator Type*() const CI0_NOEXCEPT(true)
+        {
+            return static_cast<Type*>(m_pInterface);
+        }
+    };
+
+    template <class Interface, size_t SboSize, class... Impls>
+    inline bool operator==(const ClosedPolyPtr<Interface, SboSize, Impls...>& lhs, std::nullptr_t)
+    {
+        return lhs.get() == nullptr;
+    }
+    template <class Interface, size_t SboSize, class... Impls>
+    inline bool operator==(std::nullptr_t, const ClosedPolyPtr<Interface, SboSize, Impls...>& rhs)
+    {
+        return nullptr == rhs.get();
+    }
+    template <class Interface, size_t SboSize, class... Impls>
+    inline bool operator!=(const ClosedPolyPtr<Interface, SboSize, Impls...>& lhs, std::nullptr_t)
+    {
+        return lhs.get() != nullptr;
+    }
+    template <class Interface, size_t SboSize, class... Impls>
+    inline bool operator!=(std::nullptr_t, const ClosedPolyPtr<Interface, SboSize, Impls...>& rhs)
+    {
+        return nullptr != rhs.get();
+    }
+
+    template <class Interface, size_t SboSize, class... Impls>
+    void swap(ClosedPolyPtr<Interface, SboSize, Impls...>& lhs, ClosedPolyPtr<Interface, SboSize, Impls...>& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#if _MSC_VER
+#pragma warning(pop)
+#endif
@@ -0,0 +1,288 @@
+#pragma once
+#include <stddef.h>
+#include <assert.h>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include "Noexcept.h"
+#include "ClonePtr.h"
+#include "IntrusivePtr.h"
+
+namespace ci0 {
+
+    // Shared, refcounted holder of one cloneable object.
+    // The object lives in the node's ClonePtr; small objects fit in its SBO, so a CowPtr costs one allocation.
+    template <class Interface, size_t SboSize>
+    struct CowPtrNode
+    {
+        std::atomic<size_t> refcount;
+        ClonePtr<Interface, SboSize> value;
+
+        CowPtrNode()
+            : refcount(1)
+        {
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        explicit CowPtrNode(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& value_)
+            : refcount(1)
+            , value(value_)
+        {
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        explicit CowPtrNode(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& value_)
+            : refcount(1)
+            , value(std::move(value_))
+        {
+        }
+
+        friend void intrusive_ptr_add_ref(CowPtrNode* pNode)
+        {
+            pNode->refcount.fetch_add(1, std::memory_order_relaxed);
+        }
+        friend void intrusive_ptr_release(CowPtrNode* pNode)
+        {
+            if (pNode->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                delete pNode;
+            }
+        }
+    };
+
+    // CowPtr is a copy-on-write ClonePtr.  It has the same value semantics, but copies share the object
+    // until one of them calls mutate(), which clones the object first if it is shared.
+    //  *   Reads go through a const Interface.  get(), operator->, etc. never copy.
+    //  *   mutate() returns a non-const Interface*, unique to this CowPtr until the next copy.
+    //
+    // As with any COW type, a pointer returned by mutate() must not be used after this CowPtr is copied.
+    template <class Interface, size_t SboSize = 2 * sizeof(void*)>
+    class CowPtr
+    {
+    public:
+        typedef CowPtr<Interface, SboSize> This;
+        typedef CowPtrNode<Interface, SboSize> Node;
+
+    private:
+        IntrusivePtr<Node> m_pNode;
+
+    private:
+        // prevent naked delete from compiling; http://stackoverflow.com/a/3312507
+        struct PreventDelete;
+        operator PreventDelete*() const;
+
+    public:
+        CowPtr() CI0_NOEXCEPT(true)
+        {
+        }
+        CowPtr(nullptr_t) CI0_NOEXCEPT(true)
+        {
+        }
+
+        // Copies share the object; O(1).
+        CowPtr(const This& rhs) CI0_NOEXCEPT(true)
+            : m_pNode(rhs.m_pNode)
+        {
+        }
+        CowPtr(This&& rhs) CI0_NOEXCEPT(true)
+            : m_pNode(std::move(rhs.m_pNode))
+        {
+        }
+
+        // Copy or move the contents of a ClonePtr in.
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        explicit CowPtr(const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            if (rhs)
+            {
+                m_pNode.attach(new Node(rhs), false);
+            }
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        explicit CowPtr(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            if (rhs)
+            {
+                m_pNode.attach(new Node(static_cast<const ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&>(rhs)), false);
+            }
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        explicit CowPtr(ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
+        {
+            if (rhs)
+            {
+                m_pNode.attach(new Node(std::move(rhs)), false);
+            }
+        }
+
+        // Copy or move a concrete object in.
+        template <class Object, class = typename std::enable_if<!std::is_base_of<This, typename std::decay<Object>::type>::value>::type>
+        explicit CowPtr(Object&& obj)
+        {
+            assign(std::forward<Object>(obj));
+        }
+
+        This& operator=(const This& rhs) CI0_NOEXCEPT(true)
+        {
+            m_pNode = rhs.m_pNode;
+            return *this;
+        }
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            m_pNode = std::move(rhs.m_pNode);
+            return *this;
+        }
+        This& operator=(nullptr_t) CI0_NOEXCEPT(true)
+        {
+            return reset();
+        }
+
+        // Copy or move a concrete object in.
+        template <class Object>
+        This& assign(Object&& obj)
+        {
+            typedef typename std::decay<Object>::type Obj;
+            return emplace<Obj>(std::forward<Object>(obj));
+        }
+
+        // Constructs an Object in-place from args, without a temporary.
+        //      pBase.emplace<Derived>(1, 2);
+        template <class Object, class... Args>
+        This& emplace(Args&&... args)
+        {
+            IntrusivePtr<Node> pNode(new Node(), false);
+            pNode->value.template emplace<Object>(std::forward<Args>(args)...);
+            m_pNode = std::move(pNode);
+            return *this;
+        }
+
+        This& swap(This& rhs) CI0_NOEXCEPT(true)
+        {
+            m_pNode.swap(rhs.m_pNode);
+            return *this;
+        }
+        This& swap(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            return swap(rhs);
+        }
+
+        This& reset() CI0_NOEXCEPT(true)
+        {
+            m_pNode.reset();
+            return *this;
+        }
+
+        // Returns a mutable pointer to the object, first cloning it if it is shared with other CowPtrs.
+        Interface* mutate()
+        {
+            if (!m_pNode)
+            {
+                return nullptr;
+            }
+            if (!unique())
+            {
+                IntrusivePtr<Node> pNode(new Node(m_pNode->value), false);
+                m_pNode = std::move(pNode);
+            }
+            return m_pNode->value;
+        }
+
+        // Returns a deep copy of the object, as an independent ClonePtr.
+        template <class RhsInterface = Interface, size_t RhsSboSize = sizeof(void*), size_t RhsAlign = ClonePtrDefaultAlign(RhsSboSize), class RhsAlloc = ClonePtrNewDelete>
+        ClonePtr<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc> clone() const
+        {
+            if (!m_pNode)
+            {
+                return nullptr;
+            }
+            return m_pNode->value.template copy_as<RhsInterface, RhsSboSize, RhsAlign, RhsAlloc>();
+        }
+
+        // True if no other CowPtr shares the object.  (a null CowPtr is not unique)
+        bool unique() const CI0_NOEXCEPT(true)
+        {
+            return use_count() == 1;
+        }
+        size_t use_count() const CI0_NOEXCEPT(true)
+        {
+            return m_pNode ? m_pNode->refcount.load(std::memory_order_acquire) : 0;
+        }
+
+        const Interface* get() const CI0_NOEXCEPT(true)
+        {
+            return m_pNode ? m_pNode->value.get() : nullptr;
+        }
+
+        // Exact-type test and cast; see ClonePtr::is().
+        template <class Object>
+        bool is() const CI0_NOEXCEPT(true)
+        {
+            return m_pNode && m_pNode->value.template is<Object>();
+        }
+        template <class Object>
+        const Object* as() const CI0_NOEXCEPT(true)
+        {
+            return m_pNode ? m_pNode->value.template as<Object>() : nullptr;
+        }
+
+        const Interface& operator*() const CI0_NOEXCEPT(true)
+        {
+            return *get();
+        }
+        const Interface* operator->() const CI0_NOEXCEPT(true)
+        {
+            return get();
+        }
+
+        operator const Interface*() const CI0_NOEXCEPT(true)
+        {
+            return get();
+        }
+        explicit operator bool() const CI0_NOEXCEPT(true)
+        {
+            return !!m_pNode;
+        }
+        template <class Type>
+        explicit operator const Type*() const CI0_NOEXCEPT(true)
+        {
+            return static_cast<const Type*>(get());
+        }
+    };
+
+    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
+    inline bool operator==(const CowPtr<LhsObject, LhsSboSize>& lhs, const CowPtr<RhsObject, RhsSboSize>& rhs)
+    {
+        return lhs.get() == rhs.get();
+    }
+    template <class LhsObject, size_t LhsSboSize, class RhsObject, size_t RhsSboSize>
+    inline bool operator!=(const CowPtr<LhsObject, LhsSboSize>& lhs, const CowPtr<RhsObject, RhsSboSize>& rhs)
+    {
+        return lhs.get() != rhs.get();
+    }
+
+    template <class Object, size_t SboSize>
+    inline bool operator==(const CowPtr<Object, SboSize>& lhs, std::nullptr_t)
+    {
+        return lhs.get() == nullptr;
+    }
+    template <class Object, size_t SboSize>
+    inline bool operator==(std::nullptr_t, const CowPtr<Object, SboSize>& rhs)
+    {
+        return nullptr == rhs.get();
+    }
+    template <class Object, size_t SboSize>
+    inline bool operator!=(const CowPtr<Object, SboSize>& lhs, std::nullptr_t)
+    {
+        return lhs.get() != nullptr;
+    }
+    template <class Object, size_t SboSize>
+    inline bool operator!=(std::nullptr_t, const CowPtr<Object, SboSize>& rhs)
+    {
+        return nullptr != rhs.get();
+    }
+
+    template <class Object, size_t SboSize>
+    void swap(CowPtr<Object, SboSize>& lhs, CowPtr<Object, SboSize>& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
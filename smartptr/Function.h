@@ -2,13 +2,27 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <utility>
+#include <cstddef>
 #include <type_traits>
 #include <new>
 #include "Noexcept.h"
 #include "ClonePtr.h"
+#include "IntrusivePtr.h"
 
-#define FUNCTION_ENABLE_DEBUG 01
+// FUNCTION_ENABLE_DEBUG registers a FunctionDebugEntry for every function object type stored in a Function or FuncRef.
+// It adds no per-object storage, so it may be enabled or disabled per build without changing any object layout.
+// It is opt-in: each registered type adds a dynamically initialized static (with its guard variable) to the program.
+#ifndef FUNCTION_ENABLE_DEBUG
+#define FUNCTION_ENABLE_DEBUG 0
+#endif
+#if FUNCTION_ENABLE_DEBUG
+#include <atomic>
+#endif
+
+// Expands to the template arguments of BindMember() and FuncRef::bind() for a member function pointer, before C++17.
+#define CI0_MEMBER(pMemFn) decltype(pMemFn), pMemFn
 
 #if _MSC_VER
 #pragma warning(push)
@@ -18,106 +32,196 @@
 
 namespace ci0 {
 
-    template <class TRet, class... TArgs>
-    class FuncBase
+#if FUNCTION_ENABLE_DEBUG
+    struct FunctionDebugEntry;
+
+    // Read-only debug side table, holding one FunctionDebugEntry per function object type stored in a Function or FuncRef.
+    // Debuggers can show a Function's target without it (see smartptr.natvis and smartptr_printers.py);
+    // it serves tools and logging that only have an m_wrapperFn value.
+    // note: entries are never removed, so do not walk the list after unloading a shared library that registered some.
+    class FunctionDebugRegistry
     {
     public:
-        typedef FuncBase<TRet, TArgs...> This;
-        typedef TRet(*RawFn)(TArgs... args);
+        static const FunctionDebugEntry* First()
+        {
+            return Head().load(std::memory_order_acquire);
+        }
+        template <class WrapperFn>
+        static const FunctionDebugEntry* Find(WrapperFn wrapperFn);
 
-    protected:
-        template <class RealObj>
-        struct ObjectAdapter
+    private:
+        friend struct FunctionDebugEntry;
+
+        // note: constant-initialized, so that entries may register during any dynamic initialization;
+        // atomic, so that shared libraries loaded on different threads may register concurrently
+        static std::atomic<const FunctionDebugEntry*>& Head()
         {
-            static TRet Invoke(char* pObj, TArgs... args)
+            static std::atomic<const FunctionDebugEntry*> s_pHead{ nullptr };
+            return s_pHead;
+        }
+    };
+
+    // Keyed by the type's wrapper function (FuncBase::m_wrapperFn); registered during static initialization.
+    // typeName is the compiler's signature string for FunctionDebugTypeName<Obj>(), which names Obj.
+    struct FunctionDebugEntry
+    {
+        typedef void(*ErasedFn)();
+
+        ErasedFn wrapperFn;
+        const char* typeName;
+        const FunctionDebugEntry* pNext;
+
+        FunctionDebugEntry(ErasedFn wrapperFn_, const char* typeName_)
+            : wrapperFn(wrapperFn_)
+            , typeName(typeName_)
+            , pNext(FunctionDebugRegistry::Head().load(std::memory_order_relaxed))
+        {
+            while (!FunctionDebugRegistry::Head().compare_exchange_weak(pNext, this, std::memory_order_release, std::memory_order_relaxed))
             {
-                return (*(RealObj*)pObj)(static_cast<TArgs&&>(args)...);
             }
-        };
+        }
+    };
 
-#if FUNCTION_ENABLE_DEBUG
-        struct IDebug
-        {
-            // introduce a vtable, so that the debugger can display the derived type
-            virtual void Dummy() {}
-        };
-        template <class RealObj>
-        struct DebugObjConstMemFn : IDebug
+    template <class WrapperFn>
+    const FunctionDebugEntry* FunctionDebugRegistry::Find(WrapperFn wrapperFn)
+    {
+        for (const FunctionDebugEntry* pEntry = First(); pEntry; pEntry = pEntry->pNext)
         {
-            const RealObj* pObj;
-            TRet(RealObj::*fn)(TArgs...) const;
-
-            DebugObjConstMemFn(const RealObj* pObj_, TRet(RealObj::*fn_)(TArgs...) const)
-                : pObj(pObj_)
-                , fn(fn_)
+            if (pEntry->wrapperFn == (FunctionDebugEntry::ErasedFn)wrapperFn)
             {
+                return pEntry;
             }
-        };
-        template <class RealObj>
-        struct DebugObjMemFn : IDebug
+        }
+        return nullptr;
+    }
+
+    template <class Obj>
+    const char* FunctionDebugTypeName()
+    {
+#if _MSC_VER
+        return __FUNCSIG__;
+#else
+        return __PRETTY_FUNCTION__;
+#endif
+    }
+#endif
+
+    // Function object that calls method on a receiver, where method is a compile-time constant, so the call is direct.
+    // Receiver is a raw pointer (non-owning) or an IntrusivePtr (which keeps the receiver alive); either is one pointer,
+    // so the delegate fits in the default SBO.  Created by BindMember().
+    template <class Method, Method method, class Receiver>
+    struct MemberDelegate
+    {
+        Receiver receiver;
+
+        template <class... Args>
+        decltype(auto) operator()(Args&&... args) const CI0_NOEXCEPT(noexcept(((*std::declval<const Receiver&>()).*method)(std::declval<Args>()...)))
         {
-            const RealObj* pObj;
-            TRet(RealObj::*m_fn)(TArgs...);
+            return ((*receiver).*method)(static_cast<Args&&>(args)...);
+        }
+    };
 
-            DebugObjMemFn(const RealObj* pObj_, TRet(RealObj::*fn_)(TArgs...))
-                : pObj(pObj_)
-                , fn(fn_)
-            {
-            }
-        };
+    // Binds a member function to a receiver, without allocating:
+    //      Function<void(int)> onResize = BindMember<CI0_MEMBER(&Window::OnResize)>(this);
+    //      Function<void(int)> onResize = BindMember<&Window::OnResize>(this);   // C++17
+    // A FuncRef binds a raw-pointer delegate by storing just the receiver; see also FuncRef::bind().
+    template <class Method, Method method, class Class>
+    MemberDelegate<Method, method, Class*> BindMember(Class* pReceiver) CI0_NOEXCEPT(true)
+    {
+        return MemberDelegate<Method, method, Class*>{ pReceiver };
+    }
+    template <class Method, Method method, class Class>
+    MemberDelegate<Method, method, IntrusivePtr<Class>> BindMember(IntrusivePtr<Class> pReceiver) CI0_NOEXCEPT(true)
+    {
+        return MemberDelegate<Method, method, IntrusivePtr<Class>>{ static_cast<IntrusivePtr<Class>&&>(pReceiver) };
+    }
+#if defined(__cpp_nontype_template_parameter_auto)
+    template <auto method, class Class>
+    MemberDelegate<decltype(method), method, Class*> BindMember(Class* pReceiver) CI0_NOEXCEPT(true)
+    {
+        return MemberDelegate<decltype(method), method, Class*>{ pReceiver };
+    }
+    template <auto method, class Class>
+    MemberDelegate<decltype(method), method, IntrusivePtr<Class>> BindMember(IntrusivePtr<Class> pReceiver) CI0_NOEXCEPT(true)
+    {
+        return MemberDelegate<decltype(method), method, IntrusivePtr<Class>>{ static_cast<IntrusivePtr<Class>&&>(pReceiver) };
+    }
+#endif
+
+    // Parameter type with which the wrapper function receives an argument of type T.
+    // Scalars are passed by value, in registers; everything else is passed by reference, so that it is not copied again.
+    template <class T>
+    struct FuncForwardArg
+    {
+        typedef typename std::conditional<std::is_scalar<T>::value, T, T&&>::type type;
+    };
+
+    // Function pointer types for a signature; noexcept signatures (C++17) only accept noexcept functions.
+    template <bool IsNoexcept, class TRet, class... TArgs>
+    struct FuncPointers
+    {
+        typedef TRet(*RawFn)(TArgs... args);
+        typedef TRet(*WrapperFn)(char* pObj, typename FuncForwardArg<TArgs>::type... args);
+    };
+#if defined(__cpp_noexcept_function_type)
+    template <class TRet, class... TArgs>
+    struct FuncPointers<true, TRet, TArgs...>
+    {
+        typedef TRet(*RawFn)(TArgs... args) noexcept;
+        typedef TRet(*WrapperFn)(char* pObj, typename FuncForwardArg<TArgs>::type... args) noexcept;
+    };
+#endif
+
+    // IsConst: the target is called through a const reference, so it must have a const operator().
+    // IsNoexcept: operator() is noexcept, and the target must be nothrow-callable.
+    template <bool IsConst, bool IsNoexcept, class TRet, class... TArgs>
+    class FuncBase
+    {
+    public:
+        typedef FuncBase<IsConst, IsNoexcept, TRet, TArgs...> This;
+        typedef typename FuncPointers<IsNoexcept, TRet, TArgs...>::RawFn RawFn;
+        template <bool, bool, class, class...> friend class FuncBase;
+
+    protected:
         template <class RealObj>
-        struct DebugObjStaticFn : IDebug
+        struct ObjectAdapter
         {
-            const RealObj* pObj;
-            TRet(*fn)(TArgs...);
+            typedef typename std::conditional<IsConst, const RealObj, RealObj>::type Target;
 
-            DebugObjStaticFn(const RealObj* pObj_, TRet(*fn_)(TArgs...))
-                : pObj(pObj_)
-                , fn(fn_)
+            static TRet Invoke(char* pObj, typename FuncForwardArg<TArgs>::type... args) CI0_NOEXCEPT(IsNoexcept)
             {
+                return (*(Target*)pObj)(static_cast<TArgs&&>(args)...);
             }
+#if FUNCTION_ENABLE_DEBUG
+            static const FunctionDebugEntry DebugEntry;
+#endif
         };
-        struct DebugRawFn : IDebug
-        {
-            typename RawFn rawFn;
 
-            DebugRawFn(RawFn rawFn_)
-                : rawFn(rawFn_)
+        template <class Method, Method method, class Class>
+        struct MemberAdapter
+        {
+            static TRet Invoke(char* pObj, typename FuncForwardArg<TArgs>::type... args) CI0_NOEXCEPT(IsNoexcept)
             {
+                return (((Class*)pObj)->*method)(static_cast<TArgs&&>(args)...);
             }
         };
-        struct DebugBuffer
-        {
-            void* storage[3];
-        };
-
-        template <class RealObj>
-        void CreateDebugObj(const RealObj* pObj_, TRet(RealObj::*fn_)(TArgs...) const)
-        {
-            static_assert(sizeof(DebugObjConstMemFn<RealObj>) <= sizeof(m_debugBuffer.storage), "");
-            new (m_debugBuffer.storage) DebugObjConstMemFn<RealObj>(pObj_, fn_);
-        }
-        template <class RealObj>
-        void CreateDebugObj(const RealObj* pObj_, TRet(RealObj::*fn_)(TArgs...))
-        {
-            static_assert(sizeof(DebugObjMemFn<RealObj>) <= sizeof(m_debugBuffer.storage), "");
-            new (m_debugBuffer.storage) DebugObjMemFn<RealObj>(pObj_, fn_);
-        }
-        template <class RealObj>
-        void CreateDebugObj(const RealObj* pObj_, TRet(*fn_)(TArgs...))
-        {
-            static_assert(sizeof(DebugObjStaticFn<RealObj>) <= sizeof(m_debugBuffer.storage), "");
-            new (m_debugBuffer.storage) DebugObjStaticFn<RealObj>(pObj_, fn_);
-        }
-#endif
 
     protected:
-        typedef TRet(*WrapperFn)(char* pObj, TArgs... args);
+        typedef typename FuncPointers<IsNoexcept, TRet, TArgs...>::WrapperFn WrapperFn;
         WrapperFn m_wrapperFn;
         char* m_pObj;
+
+        template <class RealObj>
+        static WrapperFn GetObjectWrapperFn()
+        {
+            typedef typename ObjectAdapter<RealObj>::Target Target;
+            static_assert(!IsNoexcept || noexcept(std::declval<Target&>()(std::declval<TArgs>()...)),
+                "a Function with a noexcept signature requires a noexcept function object");
 #if FUNCTION_ENABLE_DEBUG
-        DebugBuffer m_debugBuffer;
+            (void)&ObjectAdapter<RealObj>::DebugEntry; // odr-use the entry, so that it is instantiated and registered
 #endif
+            return &ObjectAdapter<RealObj>::Invoke;
+        }
 
     protected:
         void BaseInitNull()
@@ -125,19 +229,18 @@ namespace ci0 {
             m_wrapperFn = nullptr;
             m_pObj = nullptr;
         }
-        void BaseInitCopy(const This& rhs)
+        // note: rhs may have a different signature; see FuncBaseConvertible
+        template <bool RhsIsConst, bool RhsIsNoexcept>
+        void BaseInitCopy(const FuncBase<RhsIsConst, RhsIsNoexcept, TRet, TArgs...>& rhs)
         {
             m_wrapperFn = rhs.m_wrapperFn;
             m_pObj = rhs.m_pObj;
-#if FUNCTION_ENABLE_DEBUG
-            m_debugBuffer = rhs.m_debugBuffer;
-#endif
         }
         void BaseInitRawFn(RawFn rawFn)
         {
             struct Adapter
             {
-                static TRet Invoke(char* pObj, TArgs... args)
+                static TRet Invoke(char* pObj, typename FuncForwardArg<TArgs>::type... args) CI0_NOEXCEPT(IsNoexcept)
                 {
                     RawFn rawFn = (RawFn)pObj;
                     return rawFn(static_cast<TArgs&&>(args)...);
@@ -147,12 +250,25 @@ namespace ci0 {
             m_pObj = (char*)rawFn;
         }
         template <class RealObj>
-        void BaseInitFuncObj(RealObj&& realObj)
+        void BaseInitFuncObj(const RealObj& realObj)
         {
-            typedef typename std::decay<RealObj>::type Obj;
-            m_wrapperFn = &ObjectAdapter<Obj>::Invoke;
+            m_wrapperFn = GetObjectWrapperFn<RealObj>();
             m_pObj = (char*)&realObj;
         }
+        // Refers to the receiver rather than the delegate, so that binding a temporary delegate is safe.
+        template <class Method, Method method, class Class>
+        void BaseInitFuncObj(const MemberDelegate<Method, method, Class*>& delegate)
+        {
+            BaseInitMember<Method, method>(delegate.receiver);
+        }
+        template <class Method, Method method, class Class>
+        void BaseInitMember(Class* pReceiver)
+        {
+            static_assert(!IsNoexcept || noexcept((std::declval<Class*>()->*method)(std::declval<TArgs>()...)),
+                "a Function with a noexcept signature requires a noexcept member function");
+            m_wrapperFn = &MemberAdapter<Method, method, Class>::Invoke;
+            m_pObj = (char*)pReceiver;
+        }
 
         // no destructor
         // note: The default constructor does not initialize fields;
@@ -167,62 +283,172 @@ namespace ci0 {
             return !!m_wrapperFn;
         }
 
-        inline TRet operator()(TArgs... args) const
+        // note: each by-value argument is copied or moved once, into this function's parameter;
+        // from there it is forwarded by reference through m_wrapperFn to the target.
+        inline TRet operator()(TArgs... args) const CI0_NOEXCEPT(IsNoexcept)
         {
-            return m_wrapperFn(m_pObj, args...);
+            return m_wrapperFn(m_pObj, static_cast<TArgs&&>(args)...);
         }
     };
 
+#if FUNCTION_ENABLE_DEBUG
+    template <bool IsConst, bool IsNoexcept, class TRet, class... TArgs>
+    template <class RealObj>
+    const FunctionDebugEntry FuncBase<IsConst, IsNoexcept, TRet, TArgs...>::ObjectAdapter<RealObj>::DebugEntry(
+        (FunctionDebugEntry::ErasedFn)&FuncBase<IsConst, IsNoexcept, TRet, TArgs...>::ObjectAdapter<RealObj>::Invoke,
+        FunctionDebugTypeName<RealObj>());
+#endif
+
+    // Selects the FuncBase for a signature:
+    //      TRet(TArgs...)                  operator() const calls a non-const target, as with std::function
+    //      TRet(TArgs...) const            the target is called as const
+    //      TRet(TArgs...) noexcept         (C++17) operator() is noexcept, and so must be the target
+    //      TRet(TArgs...) const noexcept   (C++17)
+    template <class TSig>
+    struct FuncSignature;
+    template <class TRet, class... TArgs>
+    struct FuncSignature<TRet(TArgs...)>
+    {
+        typedef FuncBase<false, false, TRet, TArgs...> Base;
+    };
+    template <class TRet, class... TArgs>
+    struct FuncSignature<TRet(TArgs...) const>
+    {
+        typedef FuncBase<true, false, TRet, TArgs...> Base;
+    };
+#if defined(__cpp_noexcept_function_type)
+    template <class TRet, class... TArgs>
+    struct FuncSignature<TRet(TArgs...) noexcept>
+    {
+        typedef FuncBase<false, true, TRet, TArgs...> Base;
+    };
     template <class TRet, class... TArgs>
-    FuncBase<TRet, TArgs...> SelectFuncBase(TRet(*)(TArgs...));
+    struct FuncSignature<TRet(TArgs...) const noexcept>
+    {
+        typedef FuncBase<true, true, TRet, TArgs...> Base;
+    };
+#endif
+
+    template <class TSig>
+    using FuncBaseOf = typename FuncSignature<TSig>::Base;
+
+    // True if a wrapper with FuncBase Base can take over the target of a wrapper with FuncBase RhsBase, and keep calling it
+    // through rhs's m_wrapperFn: TRet and TArgs match, and RhsBase has every qualifier that Base has.
+    // Conversions between such wrappers copy or move the target itself, rather than wrapping the wrapper.
+    template <class Base, class RhsBase>
+    struct FuncBaseConvertible : std::false_type
+    {
+    };
+    template <bool IsConst, bool IsNoexcept, bool RhsIsConst, bool RhsIsNoexcept, class TRet, class... TArgs>
+    struct FuncBaseConvertible<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>, FuncBase<RhsIsConst, RhsIsNoexcept, TRet, TArgs...>>
+        : std::integral_constant<bool, (RhsIsConst || !IsConst) && (RhsIsNoexcept || !IsNoexcept)>
+    {
+    };
 
-    template <class TSig, size_t SboSize = sizeof(void*)>
-    class Function : public decltype(SelectFuncBase((TSig*)nullptr))
+    template <class TSig, size_t SboSize, size_t Align>
+    class UniqueFunction;
+
+    // Function objects that do not fit in the SBO are allocated through Alloc; see ClonePtrNewDelete.
+    template <class TSig, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize), class Alloc = ClonePtrNewDelete>
+    class Function : public FuncBaseOf<TSig>, private Alloc
     {
     public:
-        typedef decltype(SelectFuncBase((TSig*)nullptr)) Base;
-        typedef Function<TSig, SboSize> This;
-        template <class, size_t> friend class Function;
+        typedef FuncBaseOf<TSig> Base;
+        typedef Function<TSig, SboSize, Align, Alloc> This;
+        template <class, size_t, size_t, class> friend class Function;
+        template <class, size_t, size_t> friend class UniqueFunction;
 
     private:
-        // note: m_pDebug is placed first & in the derived class, for direct access in the debugger (fewer node expansions)
-#if FUNCTION_ENABLE_DEBUG
-        typename Base::IDebug* m_pDebug;
-#endif
+        // note: the low bit of m_pCloner (TrivialSboTag) marks a trivially copyable function object in the SBO.
+        // Such objects are copied and moved with a fixed-size memcpy of the whole SBO, and never destroyed,
+        // without dereferencing the cloner.  Cloner() strips the tag.
         const IClonePtrCloner* m_pCloner;
-        char m_sbo[SboSize];
+        alignas(Align) char m_sbo[SboSize];
+
+        static const uintptr_t TrivialSboTag = 1;
+
+        const IClonePtrCloner* Cloner() const
+        {
+            return (const IClonePtrCloner*)(uintptr_t(m_pCloner) & ~TrivialSboTag);
+        }
+        bool IsTrivialInSbo() const
+        {
+            return (uintptr_t(m_pCloner) & TrivialSboTag) != 0;
+        }
+        void SetCloner(const IClonePtrCloner* pCloner, bool isTrivialInSbo)
+        {
+            m_pCloner = (const IClonePtrCloner*)(uintptr_t(pCloner) | (isTrivialInSbo ? TrivialSboTag : 0u));
+        }
 
         // NOTE: Release() leaves m_pObj etc. pointing at a destructed object.
         // Callers must subsequently call some Init*() function (except in ~Function).
         void Release()
         {
-            if (m_pCloner)
+            if (!m_pCloner || IsTrivialInSbo())
+            {
+                return;
+            }
+            if (IsObjectInSboBuffer())
             {
-                m_pCloner->Destruct(this->m_pObj, m_sbo, SboSize);
+                if (!m_pCloner->isTriviallyDestructible)
+                {
+                    m_pCloner->pDestroyInPlace(this->m_pObj);
+                }
+                return;
             }
+            GetAlloc().Delete(m_pCloner, this->m_pObj);
+        }
+        Alloc& GetAlloc()
+        {
+            return *this;
+        }
+        const Alloc& GetAlloc() const
+        {
+            return *this;
         }
 
-#if FUNCTION_ENABLE_DEBUG
-        template <size_t RhsSboSize>
-        void InitDebugPtr(const Function<TSig, RhsSboSize>& rhs)
+        // Copies or moves a function object into the SBO if it fits, or else into storage from the allocator.
+        char* CopyObject(const IClonePtrCloner* pCloner, const char* pRhsObj)
         {
-            // TODO: make this typesafe
-            this->m_debugBuffer.storage[0] = rhs.m_debugBuffer.storage[0];
-            this->m_debugBuffer.storage[1] = this->m_pObj;
-            this->m_debugBuffer.storage[2] = rhs.m_debugBuffer.storage[2];
-            m_pDebug = (typename Base::IDebug*)this->m_debugBuffer.storage;
+            if (pCloner->FitsInSbo(SboSize, Align))
+            {
+                return pCloner->Copy(pRhsObj, m_sbo, SboSize, Align);
+            }
+            return GetAlloc().NewCopy(pCloner, pRhsObj);
+        }
+        char* MoveObject(const IClonePtrCloner* pCloner, char* pRhsObj)
+        {
+            if (pCloner->FitsInSbo(SboSize, Align))
+            {
+                return pCloner->Move(pRhsObj, m_sbo, SboSize, Align);
+            }
+            return GetAlloc().NewMove(pCloner, pRhsObj);
         }
-#endif
 
         void InitNull()
         {
             Base::BaseInitNull();
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = nullptr;
-#endif
+            m_pCloner = nullptr;
+        }
+        // Takes a trivially copyable function object from the SBO of a Function of the same type.
+        void InitTrivialInSbo(const This& rhs)
+        {
+            memcpy(m_sbo, rhs.m_sbo, SboSize);
+            this->m_pObj = m_sbo;
+            this->m_wrapperFn = rhs.m_wrapperFn;
+            m_pCloner = rhs.m_pCloner;
+        }
+        void InitCopy(const This& rhs)
+        {
+            if (rhs.IsTrivialInSbo())
+            {
+                InitTrivialInSbo(rhs);
+                return;
+            }
+            InitCopy<TSig, SboSize, Align, Alloc>(rhs);
         }
-        template <size_t RhsSboSize>
-        void InitCopy(const Function<TSig, RhsSboSize>& rhs)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy(const Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
             InitNull(); // reset members here, in case Copy() throws
             if (!rhs.m_pObj)
@@ -231,27 +457,33 @@ namespace ci0 {
             }
 
             // An object has a non-NULL cloner.
-            if (rhs.m_pCloner)
+            const IClonePtrCloner* pCloner = rhs.Cloner();
+            if (pCloner)
             {
-                this->m_pObj = rhs.m_pCloner->Copy(rhs.m_pObj, m_sbo, SboSize);
+                this->m_pObj = CopyObject(pCloner, rhs.m_pObj);
                 this->m_wrapperFn = rhs.m_wrapperFn;
-                m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-                InitDebugPtr(rhs);
-#endif
+                SetCloner(pCloner, pCloner->isTriviallyCopyable && IsObjectInSboBuffer());
                 return;
             }
 
             // rhs is a RawFn
             this->m_pObj = rhs.m_pObj;
             this->m_wrapperFn = rhs.m_wrapperFn;
-            m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-            InitDebugPtr(rhs);
-#endif
+            m_pCloner = nullptr;
+        }
+        void InitMove(This&& rhs)
+        {
+            if (rhs.IsTrivialInSbo())
+            {
+                // nothing to destroy in rhs
+                InitTrivialInSbo(rhs);
+                rhs.InitNull();
+                return;
+            }
+            InitMove<TSig, SboSize, Align, Alloc>(static_cast<This&&>(rhs));
         }
-        template <size_t RhsSboSize>
-        void InitMove(const Function<TSig, RhsSboSize>&& rhs)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove(Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
             if (!rhs.m_pObj)
             {
@@ -259,60 +491,99 @@ namespace ci0 {
                 return;
             }
 
+            const IClonePtrCloner* pCloner = rhs.Cloner();
             if (rhs.IsObjectInSboBuffer())
             {
                 // RHS Object lives in its SBO; invoke the object's move constructor.
-                this->m_pObj = rhs.m_pCloner->Move(rhs.m_pObj, m_sbo, SboSize);
+                this->m_pObj = MoveObject(pCloner, rhs.m_pObj);
                 this->m_wrapperFn = rhs.m_wrapperFn;
-                m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-                InitDebugPtr(rhs);
-#endif
+                SetCloner(pCloner, pCloner->isTriviallyCopyable && IsObjectInSboBuffer());
+                rhs.Release();
+                rhs.InitNull();
+                return;
+            }
+
+            if (pCloner && !ClonePtrAllocTraits<Alloc, RhsAlloc>::IsEqual(GetAlloc(), rhs.GetAlloc()))
+            {
+                // rhs's allocator differs from ours; relocate the object instead
+                this->m_pObj = MoveObject(pCloner, rhs.m_pObj);
+                this->m_wrapperFn = rhs.m_wrapperFn;
+                SetCloner(pCloner, pCloner->isTriviallyCopyable && IsObjectInSboBuffer());
+                rhs.Release();
                 rhs.InitNull();
                 return;
             }
 
-            // steal the object pointer
+            // steal the object pointer (or copy the RawFn)
             this->m_pObj = rhs.m_pObj;
             this->m_wrapperFn = rhs.m_wrapperFn;
-            m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-            InitDebugPtr(rhs);
-#endif
+            m_pCloner = pCloner;
             rhs.InitNull();
         }
         void InitRawFn(typename Base::RawFn rawFn)
         {
             Base::BaseInitRawFn(rawFn);
             m_pCloner = nullptr;
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = new (this->m_debugBuffer.storage) DebugRawFn(rawFn);
-#endif
         }
-        template <class RealObj>
-        void InitFuncObj(RealObj&& realObj)
+#if defined(__GNUC__)
+// Silence a spurious warning that an object is being placement-new'd into a too-small buffer; see ClonePtr.h.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wplacement-new"
+#endif
+        // Constructs the function object directly in its final location (SBO or heap).
+        template <class Obj, class... Args>
+        void EmplaceFuncObj(Args&&... args)
         {
             InitNull(); // reset members here, in case the constructor throws
-            typedef typename std::decay<RealObj>::type Obj;
-            if (std::is_nothrow_move_constructible<Obj>::value && sizeof(Obj) <= SboSize)
+            Obj* pObj;
+            if (ClonePtrFitsInSbo<Obj>(SboSize, Align))
             {
-                Obj* pObj = new (m_sbo) Obj(static_cast<RealObj&&>(realObj));
-                this->m_pObj = (char*)pObj;
+                pObj = new (m_sbo) Obj(static_cast<Args&&>(args)...);
             }
             else
             {
-                Obj* pObj = new Obj(static_cast<RealObj&&>(realObj));
-                this->m_pObj = (char*)pObj;
+                pObj = GetAlloc().template New<Obj>(static_cast<Args&&>(args)...);
             }
-            this->m_wrapperFn = &Base::ObjectAdapter<Obj>::Invoke;
-            m_pCloner = &ClonePtrCloner<Obj>::Instance;
-#if FUNCTION_ENABLE_DEBUG
-            this->CreateDebugObj<Obj>(&realObj, &Obj::operator());
+            this->m_pObj = (char*)pObj;
+            this->m_wrapperFn = Base::template GetObjectWrapperFn<Obj>();
+            SetCloner(&ClonePtrCloner<Obj>::Instance, std::is_trivially_copyable<Obj>::value && ClonePtrFitsInSbo<Obj>(SboSize, Align));
+        }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
 #endif
+        template <class Obj>
+        struct IsFlattenable : std::false_type
+        {
+        };
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        struct IsFlattenable<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj), IsFlattenable<typename std::decay<RealObj>::type>());
+        }
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj, std::false_type)
+        {
+            typedef typename std::decay<RealObj>::type Obj;
+            EmplaceFuncObj<Obj>(static_cast<RealObj&&>(realObj));
+        }
+        // rhs is a Function with a compatible signature; take its target rather than wrapping rhs.
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitFuncObj(const Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs, std::true_type)
+        {
+            InitCopy(rhs);
+        }
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitFuncObj(Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs, std::true_type)
+        {
+            InitMove(static_cast<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
         }
         bool IsObjectInSboBuffer() const
         {
-            bool result = (m_pObj - m_sbo) < SboSize;
+            bool result = uintptr_t(this->m_pObj - m_sbo) < SboSize;
             return result;
         }
 
@@ -329,41 +600,56 @@ namespace ci0 {
         {
             InitNull();
         }
+        // Allocates function objects that do not fit in the SBO through alloc.
+        Function(std::allocator_arg_t, const Alloc& alloc) CI0_NOEXCEPT(true)
+            : Alloc(alloc)
+        {
+            InitNull();
+        }
         Function(const This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy(rhs);
         }
         Function(const This&& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy(rhs);
         }
         Function(This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy(rhs);
         }
         Function(This&& rhs) CI0_NOEXCEPT(true)
+            : Alloc(rhs.GetAlloc())
         {
             InitMove(static_cast<This&&>(rhs));
         }
-        template <size_t RhsSboSize>
-        Function(const Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy(rhs);
         }
-        template <size_t RhsSboSize>
-        Function(const Function<TSig, RhsSboSize>&& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy(rhs);
         }
-        template <size_t RhsSboSize>
-        Function(Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy(rhs);
         }
-        template <size_t RhsSboSize>
-        Function(Function<TSig, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        // note: moving between different Alloc types relocates the function object, which may allocate
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnMove(rhs.GetAlloc()))
         {
-            InitMove(static_cast<Function<TSig, RhsSboSize>&&>(rhs));
+            InitMove(static_cast<Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
         }
         Function(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
         {
@@ -375,115 +661,165 @@ namespace ci0 {
             InitFuncObj(static_cast<RealObj&&>(realObj));
         }
 
-        This& operator=(std::nullptr_t)
+        // note: copy-assignment keeps this Function's allocator; move-assignment takes rhs's.
+        This& operator=(std::nullptr_t) CI0_NOEXCEPT(true)
         {
+            Release();
             InitNull();
             return *this;
         }
         This& operator=(const This& rhs)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
             return *this;
         }
         This& operator=(const This&& rhs)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
             return *this;
         }
         This& operator=(This& rhs)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
             return *this;
         }
         This& operator=(This&& rhs) CI0_NOEXCEPT(true)
         {
-            InitMove(static_cast<This&&>(rhs));
+            if (this != &rhs)
+            {
+                Release();
+                GetAlloc() = rhs.GetAlloc();
+                InitMove(static_cast<This&&>(rhs));
+            }
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(const Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
+            Release();
             InitCopy(rhs);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(const Function<TSig, RhsSboSize>&& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
+            Release();
             InitCopy(rhs);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
+            Release();
             InitCopy(rhs);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(Function<TSig, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
         {
-            InitMove(static_cast<Function<TSig, RhsSboSize>&&>(rhs));
+            Release();
+            ClonePtrAllocTraits<Alloc, RhsAlloc>::Propagate(GetAlloc(), rhs.GetAlloc());
+            InitMove(static_cast<Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
             return *this;
         }
         This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
         {
+            Release();
             InitRawFn(rawFn);
             return *this;
         }
         template <class RealObj>
         This& operator=(RealObj&& realObj)
         {
+            Release();
             InitFuncObj(static_cast<RealObj&&>(realObj));
             return *this;
         }
+
+        // Constructs a function object of type Obj in-place from args, without a temporary.
+        template <class Obj, class... Args>
+        This& emplace(Args&&... args)
+        {
+            Release();
+            EmplaceFuncObj<Obj>(static_cast<Args&&>(args)...);
+            return *this;
+        }
+
+        // Returns the stored function object if its exact type is Obj, or else nullptr.
+        // Compares cloner identity, so this costs a single pointer comparison and needs no RTTI.
+        // note: a raw function pointer is not a function object; target<>() returns nullptr for it.
+        template <class Obj>
+        Obj* target() CI0_NOEXCEPT(true)
+        {
+            return (Cloner() == &ClonePtrCloner<Obj>::Instance) ? (Obj*)this->m_pObj : nullptr;
+        }
+        template <class Obj>
+        const Obj* target() const CI0_NOEXCEPT(true)
+        {
+            return (Cloner() == &ClonePtrCloner<Obj>::Instance) ? (const Obj*)this->m_pObj : nullptr;
+        }
+
+        const Alloc& get_allocator() const CI0_NOEXCEPT(true)
+        {
+            return GetAlloc();
+        }
     };
 
     // Specialization of ClonePtr with SboSize=0.
-    template <class TSig>
-    class Function<TSig, 0u> : public decltype(SelectFuncBase((TSig*)nullptr))
+    template <class TSig, size_t Align, class Alloc>
+    class Function<TSig, 0u, Align, Alloc> : public FuncBaseOf<TSig>, private Alloc
     {
     public:
-        typedef decltype(SelectFuncBase((TSig*)nullptr)) Base;
-        typedef Function<TSig, 0u> This;
-        template <class, size_t> friend class Function;
+        typedef FuncBaseOf<TSig> Base;
+        typedef Function<TSig, 0u, Align, Alloc> This;
+        template <class, size_t, size_t, class> friend class Function;
+        template <class, size_t, size_t> friend class UniqueFunction;
 
     private:
-        // note: m_pDebug is placed first & in the derived class, for direct access in the debugger (fewer node expansions)
-#if FUNCTION_ENABLE_DEBUG
-        typename Base::IDebug* m_pDebug;
-#endif
         const IClonePtrCloner* m_pCloner;
 
+        const IClonePtrCloner* Cloner() const
+        {
+            return m_pCloner;
+        }
+
         // NOTE: Release() leaves m_pObj etc. pointing at a destructed object.
         // Callers must subsequently call some Init*() function (except in ~Function).
         void Release()
         {
             if (m_pCloner)
             {
-                m_pCloner->Destruct(this->m_pObj, nullptr, 0u);
+                GetAlloc().Delete(m_pCloner, this->m_pObj);
             }
         }
-
-#if FUNCTION_ENABLE_DEBUG
-        template <size_t RhsSboSize>
-        void InitDebugPtr(const Function<TSig, RhsSboSize>& rhs)
+        Alloc& GetAlloc()
         {
-            // TODO: make this typesafe
-            this->m_debugBuffer.storage[0] = rhs.m_debugBuffer.storage[0];
-            this->m_debugBuffer.storage[1] = this->m_pObj;
-            this->m_debugBuffer.storage[2] = rhs.m_debugBuffer.storage[2];
-            m_pDebug = (typename Base::IDebug*)this->m_debugBuffer.storage;
+            return *this;
+        }
+        const Alloc& GetAlloc() const
+        {
+            return *this;
         }
-#endif
 
         void InitNull()
         {
             Base::BaseInitNull();
             m_pCloner = nullptr;
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = nullptr;
-#endif
         }
-        void InitCopy(const This& rhs)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy(const Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
             InitNull(); // reset members here, in case Copy() throws
             if (!rhs.m_pObj)
@@ -492,26 +828,22 @@ namespace ci0 {
             }
 
             // An object has a non-NULL cloner.
-            if (rhs.m_pCloner)
+            const IClonePtrCloner* pCloner = rhs.Cloner();
+            if (pCloner)
             {
-                this->m_pObj = rhs.m_pCloner->Copy(rhs.m_pObj, nullptr, 0u);
+                this->m_pObj = GetAlloc().NewCopy(pCloner, rhs.m_pObj);
                 this->m_wrapperFn = rhs.m_wrapperFn;
-                m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-                InitDebugPtr(rhs);
-#endif
+                m_pCloner = pCloner;
                 return;
             }
 
             // rhs is a RawFn
             this->m_pObj = rhs.m_pObj;
             this->m_wrapperFn = rhs.m_wrapperFn;
-            m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-            InitDebugPtr(rhs);
-#endif
+            m_pCloner = nullptr;
         }
-        void InitMove(This&& rhs)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove(Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
             if (!rhs.m_pObj)
             {
@@ -519,48 +851,79 @@ namespace ci0 {
                 return;
             }
 
+            const IClonePtrCloner* pCloner = rhs.Cloner();
             if (rhs.IsObjectInSboBuffer())
             {
                 // RHS Object lives in its SBO; invoke the object's move constructor.
-                this->m_pObj = rhs.m_pCloner->Move(rhs.m_pObj, nullptr, 0u);
+                this->m_pObj = GetAlloc().NewMove(pCloner, rhs.m_pObj);
                 this->m_wrapperFn = rhs.m_wrapperFn;
-                m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-                InitDebugPtr(rhs);
-#endif
+                m_pCloner = pCloner;
+                rhs.Release();
+                rhs.InitNull();
+                return;
+            }
+
+            if (pCloner && !ClonePtrAllocTraits<Alloc, RhsAlloc>::IsEqual(GetAlloc(), rhs.GetAlloc()))
+            {
+                // rhs's allocator differs from ours; relocate the object instead
+                this->m_pObj = GetAlloc().NewMove(pCloner, rhs.m_pObj);
+                this->m_wrapperFn = rhs.m_wrapperFn;
+                m_pCloner = pCloner;
+                rhs.Release();
                 rhs.InitNull();
                 return;
             }
 
-            // steal the object pointer
+            // steal the object pointer (or copy the RawFn)
             this->m_pObj = rhs.m_pObj;
             this->m_wrapperFn = rhs.m_wrapperFn;
-            m_pCloner = rhs.m_pCloner;
-#if FUNCTION_ENABLE_DEBUG
-            InitDebugPtr(rhs);
-#endif
+            m_pCloner = pCloner;
             rhs.InitNull();
         }
         void InitRawFn(typename Base::RawFn rawFn)
         {
             Base::BaseInitRawFn(rawFn);
             m_pCloner = nullptr;
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = new (this->m_debugBuffer.storage) DebugRawFn(rawFn);
-#endif
         }
-        template <class RealObj>
-        void InitFuncObj(RealObj&& realObj)
+        // Constructs the function object directly in a new allocation.
+        template <class Obj, class... Args>
+        void EmplaceFuncObj(Args&&... args)
         {
             InitNull(); // reset members here, in case the constructor throws
-            typedef typename std::decay<RealObj>::type Obj;
-            Obj* pObj = new Obj(static_cast<RealObj&&>(realObj));
+            Obj* pObj = GetAlloc().template New<Obj>(static_cast<Args&&>(args)...);
             this->m_pObj = (char*)pObj;
-            this->m_wrapperFn = &Base::ObjectAdapter<Obj>::Invoke;
+            this->m_wrapperFn = Base::template GetObjectWrapperFn<Obj>();
             m_pCloner = &ClonePtrCloner<Obj>::Instance;
-#if FUNCTION_ENABLE_DEBUG
-            this->CreateDebugObj<Obj>(&realObj, &Obj::operator());
-#endif
+        }
+        template <class Obj>
+        struct IsFlattenable : std::false_type
+        {
+        };
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        struct IsFlattenable<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj), IsFlattenable<typename std::decay<RealObj>::type>());
+        }
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj, std::false_type)
+        {
+            typedef typename std::decay<RealObj>::type Obj;
+            EmplaceFuncObj<Obj>(static_cast<RealObj&&>(realObj));
+        }
+        // rhs is a Function with a compatible signature; take its target rather than wrapping rhs.
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitFuncObj(const Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs, std::true_type)
+        {
+            InitCopy(rhs);
+        }
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitFuncObj(Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs, std::true_type)
+        {
+            InitMove(static_cast<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
         }
         bool IsObjectInSboBuffer() const
         {
@@ -580,41 +943,56 @@ namespace ci0 {
         {
             InitNull();
         }
+        // Allocates function objects that do not fit in the SBO through alloc.
+        Function(std::allocator_arg_t, const Alloc& alloc) CI0_NOEXCEPT(true)
+            : Alloc(alloc)
+        {
+            InitNull();
+        }
         Function(const This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy(rhs);
         }
         Function(const This&& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy(rhs);
         }
         Function(This& rhs)
+            : Alloc(rhs.GetAlloc().SelectOnCopy())
         {
             InitCopy(rhs);
         }
         Function(This&& rhs) CI0_NOEXCEPT(true)
+            : Alloc(rhs.GetAlloc())
         {
             InitMove(static_cast<This&&>(rhs));
         }
-        template <size_t RhsSboSize>
-        Function(const Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy(rhs);
         }
-        template <size_t RhsSboSize>
-        Function(const Function<TSig, RhsSboSize>&& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy(rhs);
         }
-        template <size_t RhsSboSize>
-        Function(Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnCopy(rhs.GetAlloc()))
         {
             InitCopy(rhs);
         }
-        template <size_t RhsSboSize>
-        Function(Function<TSig, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        // note: moving between different Alloc types relocates the function object, which may allocate
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        Function(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
+            : Alloc(ClonePtrAllocTraits<Alloc, RhsAlloc>::SelectOnMove(rhs.GetAlloc()))
         {
-            InitMove(static_cast<Function<TSig, RhsSboSize>&&>(rhs));
+            InitMove(static_cast<Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
         }
         Function(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
         {
@@ -626,237 +1004,1356 @@ namespace ci0 {
             InitFuncObj(static_cast<RealObj&&>(realObj));
         }
 
-        This& operator=(std::nullptr_t)
+        // note: copy-assignment keeps this Function's allocator; move-assignment takes rhs's.
+        This& operator=(std::nullptr_t) CI0_NOEXCEPT(true)
         {
+            Release();
             InitNull();
             return *this;
         }
         This& operator=(const This& rhs)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
             return *this;
         }
         This& operator=(const This&& rhs)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
             return *this;
         }
         This& operator=(This& rhs)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
             return *this;
         }
         This& operator=(This&& rhs) CI0_NOEXCEPT(true)
         {
-            InitMove(static_cast<This&&>(rhs));
+            if (this != &rhs)
+            {
+                Release();
+                GetAlloc() = rhs.GetAlloc();
+                InitMove(static_cast<This&&>(rhs));
+            }
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(const Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
+            Release();
             InitCopy(rhs);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(const Function<TSig, RhsSboSize>&& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
         {
+            Release();
             InitCopy(rhs);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(Function<TSig, RhsSboSize>& rhs)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
         {
+            Release();
             InitCopy(rhs);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(Function<TSig, RhsSboSize>&& rhs) CI0_NOEXCEPT(true)
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs) CI0_NOEXCEPT((std::is_same<Alloc, RhsAlloc>::value))
         {
-            InitMove(static_cast<Function<TSig, RhsSboSize>&&>(rhs));
+            Release();
+            ClonePtrAllocTraits<Alloc, RhsAlloc>::Propagate(GetAlloc(), rhs.GetAlloc());
+            InitMove(static_cast<Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
             return *this;
         }
         This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
         {
+            Release();
             InitRawFn(rawFn);
             return *this;
         }
         template <class RealObj>
         This& operator=(RealObj&& realObj)
         {
+            Release();
             InitFuncObj(static_cast<RealObj&&>(realObj));
             return *this;
         }
+
+        // Constructs a function object of type Obj in-place from args, without a temporary.
+        template <class Obj, class... Args>
+        This& emplace(Args&&... args)
+        {
+            Release();
+            EmplaceFuncObj<Obj>(static_cast<Args&&>(args)...);
+            return *this;
+        }
+
+        // Returns the stored function object if its exact type is Obj, or else nullptr.
+        // Compares cloner identity, so this costs a single pointer comparison and needs no RTTI.
+        // note: a raw function pointer is not a function object; target<>() returns nullptr for it.
+        template <class Obj>
+        Obj* target() CI0_NOEXCEPT(true)
+        {
+            return (Cloner() == &ClonePtrCloner<Obj>::Instance) ? (Obj*)this->m_pObj : nullptr;
+        }
+        template <class Obj>
+        const Obj* target() const CI0_NOEXCEPT(true)
+        {
+            return (Cloner() == &ClonePtrCloner<Obj>::Instance) ? (const Obj*)this->m_pObj : nullptr;
+        }
+
+        const Alloc& get_allocator() const CI0_NOEXCEPT(true)
+        {
+            return GetAlloc();
+        }
     };
 
-    template <class TSig>
-    class FuncRef : public decltype(SelectFuncBase((TSig*)nullptr))
+    // Move-only counterpart of Function, for function objects that cannot be copied (e.g. lambdas capturing a UniquePtr).
+    // Only requires the function object to be move-constructible; it is moved into the SBO if it fits, or else onto the heap.
+    // note: SboSize=0 is legal; a 1-byte buffer is declared but never used
+    template <class TSig, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize)>
+    class UniqueFunction : public FuncBaseOf<TSig>
     {
     public:
-        typedef decltype(SelectFuncBase((TSig*)nullptr)) Base;
-        typedef FuncRef<TSig> This;
+        typedef FuncBaseOf<TSig> Base;
+        typedef UniqueFunction<TSig, SboSize, Align> This;
+        template <class, size_t, size_t> friend class UniqueFunction;
 
     private:
-        // note: m_pDebug is placed first & in the derived class, for direct access in the debugger (fewer node expansions)
-#if FUNCTION_ENABLE_DEBUG
-        typename Base::IDebug* m_pDebug;
-#endif
+        const IClonePtrMover* m_pMover;
+        alignas(Align) char m_sbo[SboSize ? SboSize : 1];
+
+    private:
+        // deleted members
+        UniqueFunction(const This& rhs);
+        UniqueFunction(const This&& rhs);
+        UniqueFunction(This& rhs);
+        This& operator=(const This& rhs);
+        This& operator=(const This&& rhs);
+        This& operator=(This& rhs);
 
     private:
+        // NOTE: Release() leaves m_pObj etc. pointing at a destructed object.
+        // Callers must subsequently call some Init*() function (except in ~UniqueFunction).
+        void Release()
+        {
+            if (m_pMover)
+            {
+                m_pMover->Destruct(this->m_pObj, m_sbo, SboSize);
+            }
+        }
+
         void InitNull()
         {
             Base::BaseInitNull();
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = nullptr;
-#endif
+            m_pMover = nullptr;
         }
-        void InitCopy(const This& rhs)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign>
+        void InitMove(UniqueFunction<RhsSig, RhsSboSize, RhsAlign>&& rhs)
         {
-            Base::BaseInitCopy(rhs);
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = (typename Base::IDebug*)this->m_debugBuffer.storage;
-#endif
+            if (rhs.m_pMover && rhs.IsObjectInSboBuffer())
+            {
+                // we cannot steal the object pointer; the move-constructor must be invoked dynamically
+                this->m_pObj = rhs.m_pMover->Move(rhs.m_pObj, m_sbo, SboSize, Align);
+                this->m_wrapperFn = rhs.m_wrapperFn;
+                m_pMover = rhs.m_pMover;
+                rhs.Release();
+                rhs.InitNull();
+                return;
+            }
+
+            // steal the object pointer (or copy the raw function pointer)
+            this->m_pObj = rhs.m_pObj;
+            this->m_wrapperFn = rhs.m_wrapperFn;
+            m_pMover = rhs.m_pMover;
+            rhs.InitNull();
+        }
+        // Takes the target of a Function; a Function's cloner is also a mover.
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitCopy(const Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs)
+        {
+            InitNull(); // reset members here, in case Copy() throws
+            const IClonePtrCloner* pCloner = rhs.Cloner();
+            if (pCloner)
+            {
+                this->m_pObj = pCloner->Copy(rhs.m_pObj, m_sbo, SboSize, Align);
+                this->m_wrapperFn = rhs.m_wrapperFn;
+                m_pMover = pCloner;
+                return;
+            }
+
+            // rhs is null or a RawFn
+            this->m_pObj = rhs.m_pObj;
+            this->m_wrapperFn = rhs.m_wrapperFn;
+        }
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitMove(Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs)
+        {
+            const IClonePtrCloner* pCloner = rhs.Cloner();
+            if (pCloner && (rhs.IsObjectInSboBuffer() || !std::is_same<RhsAlloc, ClonePtrNewDelete>::value))
+            {
+                // The object is in rhs's SBO, or was not allocated with ClonePtrHeap (which m_pMover->pDelete frees);
+                // relocate it.  note: only nothrow-move-constructible objects are ever in an SBO.
+                if (!pCloner->isNothrowMoveConstructible)
+                {
+                    InitCopy(rhs);
+                }
+                else
+                {
+                    InitNull(); // reset members here, in case the heap allocation throws
+                    this->m_pObj = pCloner->Move(rhs.m_pObj, m_sbo, SboSize, Align);
+                    this->m_wrapperFn = rhs.m_wrapperFn;
+                    m_pMover = pCloner;
+                }
+                rhs.Release();
+                rhs.InitNull();
+                return;
+            }
+
+            // steal the object pointer (or copy the raw function pointer)
+            this->m_pObj = rhs.m_pObj;
+            this->m_wrapperFn = rhs.m_wrapperFn;
+            m_pMover = pCloner;
+            rhs.InitNull();
         }
         void InitRawFn(typename Base::RawFn rawFn)
         {
             Base::BaseInitRawFn(rawFn);
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = new (this->m_debugBuffer.storage) DebugRawFn(rawFn);
+            m_pMover = nullptr;
+        }
+#if defined(__GNUC__)
+// Silence a spurious warning that an object is being placement-new'd into a too-small buffer; see ClonePtr.h.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wplacement-new"
 #endif
+        // Constructs the function object directly in its final location (SBO or heap).
+        template <class Obj, class... Args>
+        void EmplaceFuncObj(Args&&... args)
+        {
+            InitNull(); // reset members here, in case the constructor throws
+            Obj* pObj;
+            if (ClonePtrFitsInSbo<Obj>(SboSize, Align))
+            {
+                pObj = new (m_sbo) Obj(static_cast<Args&&>(args)...);
+            }
+            else
+            {
+                pObj = ClonePtrHeap<Obj>::New(static_cast<Args&&>(args)...);
+            }
+            this->m_pObj = (char*)pObj;
+            this->m_wrapperFn = Base::template GetObjectWrapperFn<Obj>();
+            m_pMover = &ClonePtrMover<Obj>::Instance;
         }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+        template <class Obj>
+        struct IsFlattenable : std::false_type
+        {
+        };
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign>
+        struct IsFlattenable<UniqueFunction<RhsSig, RhsSboSize, RhsAlign>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        struct IsFlattenable<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
         template <class RealObj>
         void InitFuncObj(RealObj&& realObj)
         {
-            typedef typename std::decay<RealObj>::type Obj;
-            Base::BaseInitFuncObj(static_cast<RealObj&&>(realObj));
-#if FUNCTION_ENABLE_DEBUG
-            this->CreateDebugObj<Obj>(&realObj, &Obj::operator());
-#endif
-        }
-        template <size_t RhsSboSize>
-        void InitFunction(const Function<TSig, RhsSboSize>& func)
-        {
-            Base::BaseInitCopy(func);
-#if FUNCTION_ENABLE_DEBUG
-            m_pDebug = (typename Base::IDebug*)this->m_debugBuffer.storage;
-#endif
+            InitFuncObj(static_cast<RealObj&&>(realObj), IsFlattenable<typename std::decay<RealObj>::type>());
         }
-
-    public:
-        // no destructor because it's just a reference
-        FuncRef() CI0_NOEXCEPT(true)
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj, std::false_type)
         {
-            InitNull();
+            typedef typename std::decay<RealObj>::type Obj;
+            EmplaceFuncObj<Obj>(static_cast<RealObj&&>(realObj));
         }
-        FuncRef(std::nullptr_t) CI0_NOEXCEPT(true)
+        // rhs is a UniqueFunction or Function with a compatible signature; take its target rather than wrapping rhs.
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign>
+        void InitFuncObj(UniqueFunction<RhsSig, RhsSboSize, RhsAlign>&& rhs, std::true_type)
         {
-            InitNull();
+            InitMove(static_cast<UniqueFunction<RhsSig, RhsSboSize, RhsAlign>&&>(rhs));
         }
-        FuncRef(const This& rhs) CI0_NOEXCEPT(true)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitFuncObj(const Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>& rhs, std::true_type)
         {
             InitCopy(rhs);
         }
-        FuncRef(const This&& rhs) CI0_NOEXCEPT(true)
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        void InitFuncObj(Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&& rhs, std::true_type)
         {
-            InitCopy(rhs);
+            InitMove(static_cast<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>&&>(rhs));
         }
-        FuncRef(This& rhs) CI0_NOEXCEPT(true)
+        bool IsObjectInSboBuffer() const
         {
-            InitCopy(rhs);
+            bool result = uintptr_t(this->m_pObj - m_sbo) < SboSize;
+            return result;
         }
-        FuncRef(This&& rhs) CI0_NOEXCEPT(true)
+
+    public:
+        ~UniqueFunction() CI0_NOEXCEPT(true)
         {
-            InitCopy(rhs);
+            Release();
         }
-        template <size_t RhsSboSize>
-        FuncRef(const Function<TSig, RhsSboSize>& func) CI0_NOEXCEPT(true)
+        UniqueFunction() CI0_NOEXCEPT(true)
         {
-            InitFunction(func);
+            InitNull();
         }
-        template <size_t RhsSboSize>
-        FuncRef(const Function<TSig, RhsSboSize>&& func) CI0_NOEXCEPT(true)
+        UniqueFunction(std::nullptr_t) CI0_NOEXCEPT(true)
         {
-            InitFunction(func);
+            InitNull();
         }
-        template <size_t RhsSboSize>
-        FuncRef(Function<TSig, RhsSboSize>& func) CI0_NOEXCEPT(true)
+        UniqueFunction(This&& rhs) CI0_NOEXCEPT(true)
         {
-            InitFunction(func);
+            InitMove(static_cast<This&&>(rhs));
         }
-        template <size_t RhsSboSize>
-        FuncRef(Function<TSig, RhsSboSize>&& func) CI0_NOEXCEPT(true)
+        template <size_t RhsSboSize, size_t RhsAlign>
+        UniqueFunction(UniqueFunction<TSig, RhsSboSize, RhsAlign>&& rhs) CI0_NOEXCEPT(true)
         {
-            InitFunction(func);
+            InitMove(static_cast<UniqueFunction<TSig, RhsSboSize, RhsAlign>&&>(rhs));
         }
-        FuncRef(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        UniqueFunction(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
         {
             InitRawFn(rawFn);
         }
+        // note: an lvalue function object is copied in; an rvalue is moved in.
         template <class RealObj>
-        FuncRef(RealObj&& realObj) CI0_NOEXCEPT(true)
+        UniqueFunction(RealObj&& realObj)
         {
             InitFuncObj(static_cast<RealObj&&>(realObj));
         }
 
         This& operator=(std::nullptr_t) CI0_NOEXCEPT(true)
         {
+            Release();
             InitNull();
             return *this;
         }
-        This& operator=(const This& rhs) CI0_NOEXCEPT(true)
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
         {
-            InitCopy(rhs);
+            if (this != &rhs)
+            {
+                Release();
+                InitMove(static_cast<This&&>(rhs));
+            }
             return *this;
         }
-        This& operator=(const This&& rhs) CI0_NOEXCEPT(true)
+        template <size_t RhsSboSize, size_t RhsAlign>
+        This& operator=(UniqueFunction<TSig, RhsSboSize, RhsAlign>&& rhs) CI0_NOEXCEPT(true)
         {
-            InitCopy(rhs);
+            Release();
+            InitMove(static_cast<UniqueFunction<TSig, RhsSboSize, RhsAlign>&&>(rhs));
             return *this;
         }
-        This& operator=(This& rhs) CI0_NOEXCEPT(true)
+        This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
         {
-            InitCopy(rhs);
+            Release();
+            InitRawFn(rawFn);
             return *this;
         }
-        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        template <class RealObj>
+        This& operator=(RealObj&& realObj)
         {
-            InitCopy(rhs);
+            Release();
+            InitFuncObj(static_cast<RealObj&&>(realObj));
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(const Function<TSig, RhsSboSize>& func) CI0_NOEXCEPT(true)
+
+        // Constructs a function object of type Obj in-place from args, without a temporary.
+        template <class Obj, class... Args>
+        This& emplace(Args&&... args)
         {
-            InitFunction(func);
+            Release();
+            EmplaceFuncObj<Obj>(static_cast<Args&&>(args)...);
             return *this;
         }
-        template <size_t RhsSboSize>
-        This& operator=(const Function<TSig, RhsSboSize>&& func) CI0_NOEXCEPT(true)
+
+        // Returns the stored function object if its exact type is Obj, or else nullptr.  (see Function::target)
+        template <class Obj>
+        Obj* target() CI0_NOEXCEPT(true)
         {
-            InitFunction(func);
-            return *this;
+            return IsTarget<Obj>() ? (Obj*)this->m_pObj : nullptr;
         }
-        template <size_t RhsSboSize>
-        This& operator=(Function<TSig, RhsSboSize>& func) CI0_NOEXCEPT(true)
+        template <class Obj>
+        const Obj* target() const CI0_NOEXCEPT(true)
         {
-            InitFunction(func);
-            return *this;
+            return IsTarget<Obj>() ? (const Obj*)this->m_pObj : nullptr;
         }
-        template <size_t RhsSboSize>
-        This& operator=(Function<TSig, RhsSboSize>&& func) CI0_NOEXCEPT(true)
+
+    private:
+        // note: a target taken from a Function keeps the Function's cloner as its mover.
+        template <class Obj>
+        bool IsTarget() const
         {
-            InitFunction(func);
-            return *this;
+            return m_pMover == &ClonePtrMover<Obj>::Instance || IsClonerOf<Obj>(std::is_copy_constructible<Obj>());
         }
-        This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        template <class Obj>
+        bool IsClonerOf(std::true_type) const
         {
-            AssignRaw(rawFn);
-            return *this;
+            return m_pMover == &ClonePtrCloner<Obj>::Instance;
         }
-        template <class RealObj>
-        This& operator=(RealObj&& realObj) CI0_NOEXCEPT(true)
+        template <class Obj>
+        bool IsClonerOf(std::false_type) const
         {
-            InitFuncObj(static_cast<RealObj&&>(realObj));
-            return *this;
+            return false;
+        }
+    };
+
+    // Function that never allocates: every function object lives in a Capacity-byte buffer.
+    // Assigning a function object that is too big, over-aligned, or not nothrow-move-constructible fails to compile.
+    // FixedFunctionFor<Sig, Objs...> has the minimal Capacity and Align for the given function object types.
+    // note: Capacity=0 is legal, for raw function pointers only; a 1-byte buffer is declared but never used
+    template <class TSig, size_t Capacity = sizeof(void*), size_t Align = ClonePtrDefaultAlign(Capacity)>
+    class FixedFunction : public FuncBaseOf<TSig>
+    {
+    public:
+        typedef FuncBaseOf<TSig> Base;
+        typedef FixedFunction<TSig, Capacity, Align> This;
+        template <class, size_t, size_t> friend class FixedFunction;
+
+    private:
+        const IClonePtrCloner* m_pCloner;
+        alignas(Align) char m_sbo[Capacity ? Capacity : 1];
+
+        // NOTE: Release() leaves m_pObj etc. pointing at a destructed object.
+        // Callers must subsequently call some Init*() function (except in ~FixedFunction).
+        void Release()
+        {
+            if (m_pCloner && !m_pCloner->isTriviallyDestructible)
+            {
+                m_pCloner->pDestroyInPlace(this->m_pObj);
+            }
+        }
+
+        template <size_t RhsCapacity, size_t RhsAlign>
+        static void CheckFits()
+        {
+            static_assert(RhsCapacity <= Capacity, "FixedFunction: rhs's Capacity exceeds this Capacity");
+            static_assert(RhsAlign <= Align, "FixedFunction: rhs's Align exceeds this Align");
         }
+
+        void InitNull()
+        {
+            Base::BaseInitNull();
+            m_pCloner = nullptr;
+        }
+        template <class RhsSig, size_t RhsCapacity, size_t RhsAlign>
+        void InitCopy(const FixedFunction<RhsSig, RhsCapacity, RhsAlign>& rhs)
+        {
+            CheckFits<RhsCapacity, RhsAlign>();
+            InitNull(); // reset members here, in case Copy() throws
+            if (rhs.m_pCloner)
+            {
+                this->m_pObj = rhs.m_pCloner->Copy(rhs.m_pObj, m_sbo, Capacity, Align);
+                this->m_wrapperFn = rhs.m_wrapperFn;
+                m_pCloner = rhs.m_pCloner;
+                return;
+            }
+
+            // rhs is null or a RawFn
+            this->m_pObj = rhs.m_pObj;
+            this->m_wrapperFn = rhs.m_wrapperFn;
+        }
+        template <class RhsSig, size_t RhsCapacity, size_t RhsAlign>
+        void InitMove(FixedFunction<RhsSig, RhsCapacity, RhsAlign>&& rhs)
+        {
+            CheckFits<RhsCapacity, RhsAlign>();
+            if (rhs.m_pCloner)
+            {
+                this->m_pObj = rhs.m_pCloner->Move(rhs.m_pObj, m_sbo, Capacity, Align);
+                this->m_wrapperFn = rhs.m_wrapperFn;
+                m_pCloner = rhs.m_pCloner;
+                rhs.Release();
+                rhs.InitNull();
+                return;
+            }
+
+            // rhs is null or a RawFn
+            this->m_pObj = rhs.m_pObj;
+            this->m_wrapperFn = rhs.m_wrapperFn;
+            m_pCloner = nullptr;
+            rhs.InitNull();
+        }
+        void InitRawFn(typename Base::RawFn rawFn)
+        {
+            Base::BaseInitRawFn(rawFn);
+            m_pCloner = nullptr;
+        }
+        // Constructs the function object directly in the buffer.
+        template <class Obj, class... Args>
+        void EmplaceFuncObj(Args&&... args)
+        {
+            static_assert(sizeof(Obj) <= Capacity, "FixedFunction: the function object does not fit in Capacity; see FixedFunctionFor");
+            static_assert(alignof(Obj) <= Align, "FixedFunction: the function object is over-aligned for Align; see FixedFunctionFor");
+            static_assert(std::is_nothrow_move_constructible<Obj>::value, "FixedFunction: the function object must be nothrow-move-constructible");
+            InitNull(); // reset members here, in case the constructor throws
+            this->m_pObj = (char*)new (m_sbo) Obj(static_cast<Args&&>(args)...);
+            this->m_wrapperFn = Base::template GetObjectWrapperFn<Obj>();
+            m_pCloner = &ClonePtrCloner<Obj>::Instance;
+        }
+        template <class Obj>
+        struct IsFlattenable : std::false_type
+        {
+        };
+        template <class RhsSig, size_t RhsCapacity, size_t RhsAlign>
+        struct IsFlattenable<FixedFunction<RhsSig, RhsCapacity, RhsAlign>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj), IsFlattenable<typename std::decay<RealObj>::type>());
+        }
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj, std::false_type)
+        {
+            typedef typename std::decay<RealObj>::type Obj;
+            EmplaceFuncObj<Obj>(static_cast<RealObj&&>(realObj));
+        }
+        // rhs is a FixedFunction with a compatible signature; take its target rather than wrapping rhs.
+        template <class RhsSig, size_t RhsCapacity, size_t RhsAlign>
+        void InitFuncObj(const FixedFunction<RhsSig, RhsCapacity, RhsAlign>& rhs, std::true_type)
+        {
+            InitCopy(rhs);
+        }
+        template <class RhsSig, size_t RhsCapacity, size_t RhsAlign>
+        void InitFuncObj(FixedFunction<RhsSig, RhsCapacity, RhsAlign>&& rhs, std::true_type)
+        {
+            InitMove(static_cast<FixedFunction<RhsSig, RhsCapacity, RhsAlign>&&>(rhs));
+        }
+
+    public:
+        ~FixedFunction() CI0_NOEXCEPT(true)
+        {
+            Release();
+        }
+        FixedFunction() CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        FixedFunction(std::nullptr_t) CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        FixedFunction(const This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        FixedFunction(const This&& rhs)
+        {
+            InitCopy(rhs);
+        }
+        FixedFunction(This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        FixedFunction(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove(static_cast<This&&>(rhs));
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FixedFunction(const FixedFunction<TSig, RhsCapacity, RhsAlign>& rhs)
+        {
+            InitCopy(rhs);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FixedFunction(const FixedFunction<TSig, RhsCapacity, RhsAlign>&& rhs)
+        {
+            InitCopy(rhs);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FixedFunction(FixedFunction<TSig, RhsCapacity, RhsAlign>& rhs)
+        {
+            InitCopy(rhs);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FixedFunction(FixedFunction<TSig, RhsCapacity, RhsAlign>&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove(static_cast<FixedFunction<TSig, RhsCapacity, RhsAlign>&&>(rhs));
+        }
+        FixedFunction(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        {
+            InitRawFn(rawFn);
+        }
+        template <class RealObj>
+        FixedFunction(RealObj&& realObj)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj));
+        }
+
+        This& operator=(std::nullptr_t) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitNull();
+            return *this;
+        }
+        This& operator=(const This& rhs)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
+            return *this;
+        }
+        This& operator=(const This&& rhs)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
+            return *this;
+        }
+        This& operator=(This& rhs)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
+            return *this;
+        }
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitMove(static_cast<This&&>(rhs));
+            }
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(const FixedFunction<TSig, RhsCapacity, RhsAlign>& rhs)
+        {
+            Release();
+            InitCopy(rhs);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(const FixedFunction<TSig, RhsCapacity, RhsAlign>&& rhs)
+        {
+            Release();
+            InitCopy(rhs);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(FixedFunction<TSig, RhsCapacity, RhsAlign>& rhs)
+        {
+            Release();
+            InitCopy(rhs);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(FixedFunction<TSig, RhsCapacity, RhsAlign>&& rhs) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitMove(static_cast<FixedFunction<TSig, RhsCapacity, RhsAlign>&&>(rhs));
+            return *this;
+        }
+        This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitRawFn(rawFn);
+            return *this;
+        }
+        template <class RealObj>
+        This& operator=(RealObj&& realObj)
+        {
+            Release();
+            InitFuncObj(static_cast<RealObj&&>(realObj));
+            return *this;
+        }
+
+        // Constructs a function object of type Obj in-place from args, without a temporary.
+        template <class Obj, class... Args>
+        This& emplace(Args&&... args)
+        {
+            Release();
+            EmplaceFuncObj<Obj>(static_cast<Args&&>(args)...);
+            return *this;
+        }
+
+        // Returns the stored function object if its exact type is Obj, or else nullptr.  (see Function::target)
+        template <class Obj>
+        Obj* target() CI0_NOEXCEPT(true)
+        {
+            return (m_pCloner == &ClonePtrCloner<Obj>::Instance) ? (Obj*)this->m_pObj : nullptr;
+        }
+        template <class Obj>
+        const Obj* target() const CI0_NOEXCEPT(true)
+        {
+            return (m_pCloner == &ClonePtrCloner<Obj>::Instance) ? (const Obj*)this->m_pObj : nullptr;
+        }
+    };
+
+    // The minimal FixedFunction Capacity and Align that hold any of the function object types Objs.
+    template <class... Objs>
+    struct FixedFunctionCapacity;
+    template <>
+    struct FixedFunctionCapacity<>
+    {
+        static const size_t size = 0;
+        static const size_t align = 1;
+    };
+    template <class Obj, class... Objs>
+    struct FixedFunctionCapacity<Obj, Objs...>
+    {
+        static const size_t size = sizeof(Obj) > FixedFunctionCapacity<Objs...>::size ? sizeof(Obj) : FixedFunctionCapacity<Objs...>::size;
+        static const size_t align = alignof(Obj) > FixedFunctionCapacity<Objs...>::align ? alignof(Obj) : FixedFunctionCapacity<Objs...>::align;
+    };
+
+    //      auto onTick = [this, &stats](int frame) { ... };
+    //      FixedFunctionFor<void(int), decltype(onTick)> tickFn = onTick;
+    template <class TSig, class... Objs>
+    using FixedFunctionFor = FixedFunction<TSig, FixedFunctionCapacity<Objs...>::size, FixedFunctionCapacity<Objs...>::align>;
+
+    // Returns a FixedFunction sized exactly for realObj.
+    template <class TSig, class RealObj>
+    FixedFunctionFor<TSig, typename std::decay<RealObj>::type> MakeFixedFunction(RealObj&& realObj)
+    {
+        return FixedFunctionFor<TSig, typename std::decay<RealObj>::type>(static_cast<RealObj&&>(realObj));
+    }
+
+    template <class Base>
+    class CompactFuncBase;
+
+    // The part of CompactFunction that depends only on the signature (see FuncBase).
+    template <bool IsConst, bool IsNoexcept, class TRet, class... TArgs>
+    class CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>
+    {
+    public:
+        typedef CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>> This;
+        typedef typename FuncPointers<IsNoexcept, TRet, TArgs...>::RawFn RawFn;
+
+    protected:
+        // note: a CompactFunction's wrapperFn takes the CompactFunction itself, and finds the function object through Locate.
+        typedef typename FuncPointers<IsNoexcept, TRet, TArgs...>::WrapperFn WrapperFn;
+
+        // One static instance per stored type and Locate.
+        struct Descriptor
+        {
+            WrapperFn wrapperFn;
+            // nullptr for a raw function pointer
+            const IClonePtrCloner* pCloner;
+            // the object is in the SBO; otherwise the SBO holds a pointer to it
+            bool isInSbo;
+            // the SBO is copied and moved with memcpy, and nothing needs to be destroyed
+            bool isTrivial;
+        };
+
+        template <class RealObj, class Locate>
+        struct ObjectAdapter
+        {
+            typedef typename std::conditional<IsConst, const RealObj, RealObj>::type Target;
+
+            static TRet Invoke(char* pFunc, typename FuncForwardArg<TArgs>::type... args) CI0_NOEXCEPT(IsNoexcept)
+            {
+                return (*(Target*)Locate::Object(pFunc))(static_cast<TArgs&&>(args)...);
+            }
+            static const Descriptor Desc;
+#if FUNCTION_ENABLE_DEBUG
+            static const FunctionDebugEntry DebugEntry;
+#endif
+        };
+
+        template <class Locate>
+        struct RawFnAdapter
+        {
+            static TRet Invoke(char* pFunc, typename FuncForwardArg<TArgs>::type... args) CI0_NOEXCEPT(IsNoexcept)
+            {
+                RawFn rawFn = *(RawFn*)Locate::Object(pFunc);
+                return rawFn(static_cast<TArgs&&>(args)...);
+            }
+            static const Descriptor Desc;
+        };
+
+    protected:
+        const Descriptor* m_pDesc;
+
+        template <class RealObj, class Locate>
+        static const Descriptor* GetObjectDescriptor()
+        {
+            typedef typename ObjectAdapter<RealObj, Locate>::Target Target;
+            static_assert(!IsNoexcept || noexcept(std::declval<Target&>()(std::declval<TArgs>()...)),
+                "a Function with a noexcept signature requires a noexcept function object");
+#if FUNCTION_ENABLE_DEBUG
+            (void)&ObjectAdapter<RealObj, Locate>::DebugEntry; // odr-use the entry, so that it is instantiated and registered
+#endif
+            return &ObjectAdapter<RealObj, Locate>::Desc;
+        }
+
+        // no destructor
+        // note: The default constructor does not initialize m_pDesc;
+        // the derived class must call the appropriate Init*() function instead.
+        CompactFuncBase()
+        {
+        }
+
+    public:
+        explicit operator bool() const
+        {
+            return !!m_pDesc;
+        }
+
+        inline TRet operator()(TArgs... args) const CI0_NOEXCEPT(IsNoexcept)
+        {
+            return m_pDesc->wrapperFn((char*)this, static_cast<TArgs&&>(args)...);
+        }
+    };
+
+    template <bool IsConst, bool IsNoexcept, class TRet, class... TArgs>
+    template <class RealObj, class Locate>
+    const typename CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>::Descriptor
+        CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>::ObjectAdapter<RealObj, Locate>::Desc = {
+            &Invoke, &ClonePtrCloner<RealObj>::Instance, Locate::isInSbo, Locate::isInSbo && std::is_trivially_copyable<RealObj>::value };
+
+    template <bool IsConst, bool IsNoexcept, class TRet, class... TArgs>
+    template <class Locate>
+    const typename CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>::Descriptor
+        CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>::RawFnAdapter<Locate>::Desc = {
+            &Invoke, nullptr, true, true };
+
+#if FUNCTION_ENABLE_DEBUG
+    template <bool IsConst, bool IsNoexcept, class TRet, class... TArgs>
+    template <class RealObj, class Locate>
+    const FunctionDebugEntry CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>::ObjectAdapter<RealObj, Locate>::DebugEntry(
+        (FunctionDebugEntry::ErasedFn)&CompactFuncBase<FuncBase<IsConst, IsNoexcept, TRet, TArgs...>>::ObjectAdapter<RealObj, Locate>::Invoke,
+        FunctionDebugTypeName<RealObj>());
+#endif
+
+    // Function with the smallest layout: a pointer to a static descriptor of the stored type (its trampoline and cloner),
+    // followed by the SBO.  A function object that does not fit in the SBO is put on the heap, and the SBO holds a pointer to it.
+    // With the defaults, a CompactFunction is two pointers, and stores a lambda capturing one pointer without allocating;
+    // this suits large tables of callbacks (timers, event handlers).  A default Function is four pointers, and saves one load per call.
+    // note: the descriptor is specific to this CompactFunction type, so converting between CompactFunctions
+    // of different SboSize or Align wraps one in the other.  Heap objects use operator new; there is no Alloc parameter.
+    template <class TSig, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize)>
+    class CompactFunction : public CompactFuncBase<FuncBaseOf<TSig>>
+    {
+        static_assert(SboSize >= sizeof(void*) && Align >= alignof(void*), "CompactFunction: the SBO must be able to hold a pointer");
+
+    public:
+        typedef CompactFuncBase<FuncBaseOf<TSig>> Base;
+        typedef CompactFunction<TSig, SboSize, Align> This;
+
+    private:
+        typedef typename Base::Descriptor Descriptor;
+        alignas(Align) char m_sbo[SboSize];
+
+        // Find the function object of a CompactFunction, for the adapters; the descriptor's isInSbo selects one.
+        struct InSbo
+        {
+            static const bool isInSbo = true;
+            static char* Object(char* pFunc)
+            {
+                return static_cast<This*>((Base*)pFunc)->m_sbo;
+            }
+        };
+        struct OnHeap
+        {
+            static const bool isInSbo = false;
+            static char* Object(char* pFunc)
+            {
+                return *(char**)static_cast<This*>((Base*)pFunc)->m_sbo;
+            }
+        };
+
+        char* Object() const
+        {
+            return this->m_pDesc->isInSbo ? (char*)m_sbo : *(char**)m_sbo;
+        }
+
+        // NOTE: Release() leaves m_pDesc pointing at the descriptor of a destructed object.
+        // Callers must subsequently call some Init*() function (except in ~CompactFunction).
+        void Release()
+        {
+            const Descriptor* pDesc = this->m_pDesc;
+            if (!pDesc || pDesc->isTrivial)
+            {
+                return;
+            }
+            if (pDesc->isInSbo)
+            {
+                if (!pDesc->pCloner->isTriviallyDestructible)
+                {
+                    pDesc->pCloner->pDestroyInPlace(m_sbo);
+                }
+                return;
+            }
+            pDesc->pCloner->pDelete(*(char**)m_sbo);
+        }
+
+        void InitNull()
+        {
+            this->m_pDesc = nullptr;
+        }
+        void InitCopy(const This& rhs)
+        {
+            const Descriptor* pDesc = rhs.m_pDesc;
+            if (!pDesc)
+            {
+                InitNull();
+                return;
+            }
+            if (pDesc->isTrivial)
+            {
+                memcpy(m_sbo, rhs.m_sbo, SboSize);
+                this->m_pDesc = pDesc;
+                return;
+            }
+
+            InitNull(); // reset members here, in case the copy throws
+            if (pDesc->isInSbo)
+            {
+                pDesc->pCloner->pCopyConstruct(rhs.m_sbo, m_sbo);
+            }
+            else
+            {
+                *(char**)m_sbo = pDesc->pCloner->pCopy(*(char* const*)rhs.m_sbo, nullptr, 0u, 0u);
+            }
+            this->m_pDesc = pDesc;
+        }
+        void InitMove(This&& rhs)
+        {
+            const Descriptor* pDesc = rhs.m_pDesc;
+            if (!pDesc)
+            {
+                InitNull();
+                return;
+            }
+            if (pDesc->isInSbo && !pDesc->isTrivial)
+            {
+                // only nothrow-move-constructible objects are put in the SBO
+                pDesc->pCloner->pMoveConstruct(rhs.m_sbo, m_sbo);
+                rhs.Release();
+            }
+            else
+            {
+                // a trivially copyable object or a raw function pointer, or else steal the object pointer
+                memcpy(m_sbo, rhs.m_sbo, SboSize);
+            }
+            this->m_pDesc = pDesc;
+            rhs.InitNull();
+        }
+        void InitRawFn(typename Base::RawFn rawFn)
+        {
+            *(typename Base::RawFn*)m_sbo = rawFn;
+            this->m_pDesc = &Base::template RawFnAdapter<InSbo>::Desc;
+        }
+#if defined(__GNUC__)
+// Silence a spurious warning that an object is being placement-new'd into a too-small buffer; see ClonePtr.h.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wplacement-new"
+#endif
+        // Constructs the function object directly in its final location (SBO or heap).
+        template <class Obj, class... Args>
+        void EmplaceFuncObj(Args&&... args)
+        {
+            InitNull(); // reset members here, in case the constructor throws
+            if (ClonePtrFitsInSbo<Obj>(SboSize, Align))
+            {
+                new (m_sbo) Obj(static_cast<Args&&>(args)...);
+                this->m_pDesc = Base::template GetObjectDescriptor<Obj, InSbo>();
+                return;
+            }
+            *(Obj**)m_sbo = ClonePtrHeap<Obj>::New(static_cast<Args&&>(args)...);
+            this->m_pDesc = Base::template GetObjectDescriptor<Obj, OnHeap>();
+        }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+        template <class RealObj>
+        void InitFuncObj(RealObj&& realObj)
+        {
+            typedef typename std::decay<RealObj>::type Obj;
+            EmplaceFuncObj<Obj>(static_cast<RealObj&&>(realObj));
+        }
+
+    public:
+        ~CompactFunction() CI0_NOEXCEPT(true)
+        {
+            Release();
+        }
+        CompactFunction() CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        CompactFunction(std::nullptr_t) CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        CompactFunction(const This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        CompactFunction(const This&& rhs)
+        {
+            InitCopy(rhs);
+        }
+        CompactFunction(This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        CompactFunction(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove(static_cast<This&&>(rhs));
+        }
+        CompactFunction(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        {
+            InitRawFn(rawFn);
+        }
+        template <class RealObj>
+        CompactFunction(RealObj&& realObj)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj));
+        }
+
+        This& operator=(std::nullptr_t) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitNull();
+            return *this;
+        }
+        This& operator=(const This& rhs)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
+            return *this;
+        }
+        This& operator=(const This&& rhs)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
+            return *this;
+        }
+        This& operator=(This& rhs)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitCopy(rhs);
+            }
+            return *this;
+        }
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitMove(static_cast<This&&>(rhs));
+            }
+            return *this;
+        }
+        This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitRawFn(rawFn);
+            return *this;
+        }
+        // note: realObj may be (or be owned by) the current target, e.g. fn = *fn.target<X>(), so it is copied before Release()
+        template <class RealObj>
+        This& operator=(RealObj&& realObj)
+        {
+            This temp(static_cast<RealObj&&>(realObj));
+            Release();
+            InitMove(static_cast<This&&>(temp));
+            return *this;
+        }
+
+        // Constructs a function object of type Obj in-place from args, without a temporary.
+        template <class Obj, class... Args>
+        This& emplace(Args&&... args)
+        {
+            Release();
+            EmplaceFuncObj<Obj>(static_cast<Args&&>(args)...);
+            return *this;
+        }
+
+        // Returns the stored function object if its exact type is Obj, or else nullptr.  (see Function::target)
+        template <class Obj>
+        Obj* target() CI0_NOEXCEPT(true)
+        {
+            return (this->m_pDesc && this->m_pDesc->pCloner == &ClonePtrCloner<Obj>::Instance) ? (Obj*)Object() : nullptr;
+        }
+        template <class Obj>
+        const Obj* target() const CI0_NOEXCEPT(true)
+        {
+            return (this->m_pDesc && this->m_pDesc->pCloner == &ClonePtrCloner<Obj>::Instance) ? (const Obj*)Object() : nullptr;
+        }
+    };
+
+    template <class TSig>
+    class FuncRef : public FuncBaseOf<TSig>
+    {
+    public:
+        typedef FuncBaseOf<TSig> Base;
+        typedef FuncRef<TSig> This;
+
+    private:
+        void InitNull()
+        {
+            Base::BaseInitNull();
+        }
+        void InitRawFn(typename Base::RawFn rawFn)
+        {
+            Base::BaseInitRawFn(rawFn);
+        }
+        template <class Obj>
+        struct IsFlattenable : std::false_type
+        {
+        };
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        struct IsFlattenable<Function<RhsSig, RhsSboSize, RhsAlign, RhsAlloc>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RhsSig, size_t RhsSboSize, size_t RhsAlign>
+        struct IsFlattenable<UniqueFunction<RhsSig, RhsSboSize, RhsAlign>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RhsSig, size_t RhsCapacity, size_t RhsAlign>
+        struct IsFlattenable<FixedFunction<RhsSig, RhsCapacity, RhsAlign>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RhsSig>
+        struct IsFlattenable<FuncRef<RhsSig>> : FuncBaseConvertible<Base, FuncBaseOf<RhsSig>>
+        {
+        };
+        template <class RealObj>
+        void InitFuncObj(const RealObj& realObj)
+        {
+            InitFuncObj(realObj, IsFlattenable<RealObj>());
+        }
+        template <class RealObj>
+        void InitFuncObj(const RealObj& realObj, std::false_type)
+        {
+            Base::BaseInitFuncObj(realObj);
+        }
+        // realObj is a function wrapper with a compatible signature; refer to its target rather than to realObj.
+        template <class RealObj>
+        void InitFuncObj(const RealObj& realObj, std::true_type)
+        {
+            InitFunction(realObj);
+        }
+        // Refers to the target of a Function, UniqueFunction, FixedFunction or FuncRef.
+        template <class RhsBase>
+        void InitFunction(const RhsBase& func)
+        {
+            Base::BaseInitCopy(func);
+        }
+
+    public:
+        // no destructor because it's just a reference
+        FuncRef() CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        FuncRef(std::nullptr_t) CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        // note: copies are trivial, so that a FuncRef is passed in two registers (where the ABI allows).
+        FuncRef(const This& rhs) = default;
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        FuncRef(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        FuncRef(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        FuncRef(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        FuncRef(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        FuncRef(const UniqueFunction<TSig, RhsSboSize, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        FuncRef(const UniqueFunction<TSig, RhsSboSize, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        FuncRef(UniqueFunction<TSig, RhsSboSize, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        FuncRef(UniqueFunction<TSig, RhsSboSize, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FuncRef(const FixedFunction<TSig, RhsCapacity, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FuncRef(const FixedFunction<TSig, RhsCapacity, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FuncRef(FixedFunction<TSig, RhsCapacity, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        FuncRef(FixedFunction<TSig, RhsCapacity, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+        }
+        FuncRef(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        {
+            InitRawFn(rawFn);
+        }
+        // note: FuncRef itself is excluded, so that copying a non-const or rvalue FuncRef uses the trivial copy
+        template <class RealObj, class = typename std::enable_if<!std::is_same<typename std::decay<RealObj>::type, This>::value>::type>
+        FuncRef(RealObj&& realObj) CI0_NOEXCEPT(true)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj));
+        }
+
+        This& operator=(std::nullptr_t) CI0_NOEXCEPT(true)
+        {
+            InitNull();
+            return *this;
+        }
+        This& operator=(const This& rhs) = default;
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(const Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign, class RhsAlloc>
+        This& operator=(Function<TSig, RhsSboSize, RhsAlign, RhsAlloc>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        This& operator=(const UniqueFunction<TSig, RhsSboSize, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        This& operator=(const UniqueFunction<TSig, RhsSboSize, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        This& operator=(UniqueFunction<TSig, RhsSboSize, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsSboSize, size_t RhsAlign>
+        This& operator=(UniqueFunction<TSig, RhsSboSize, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(const FixedFunction<TSig, RhsCapacity, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(const FixedFunction<TSig, RhsCapacity, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(FixedFunction<TSig, RhsCapacity, RhsAlign>& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        template <size_t RhsCapacity, size_t RhsAlign>
+        This& operator=(FixedFunction<TSig, RhsCapacity, RhsAlign>&& func) CI0_NOEXCEPT(true)
+        {
+            InitFunction(func);
+            return *this;
+        }
+        This& operator=(typename Base::RawFn rawFn) CI0_NOEXCEPT(true)
+        {
+            InitRawFn(rawFn);
+            return *this;
+        }
+        template <class RealObj, class = typename std::enable_if<!std::is_same<typename std::decay<RealObj>::type, This>::value>::type>
+        This& operator=(RealObj&& realObj) CI0_NOEXCEPT(true)
+        {
+            InitFuncObj(static_cast<RealObj&&>(realObj));
+            return *this;
+        }
+
+        // Returns a FuncRef that calls method on pReceiver directly; only the receiver pointer is stored.
+        //      FuncRef<void(int)> onResize = FuncRef<void(int)>::bind<CI0_MEMBER(&Window::OnResize)>(this);
+        //      FuncRef<void(int)> onResize = FuncRef<void(int)>::bind<&Window::OnResize>(this);   // C++17
+        template <class Method, Method method, class Class>
+        static This bind(Class* pReceiver) CI0_NOEXCEPT(true)
+        {
+            This result;
+            result.template BaseInitMember<Method, method>(pReceiver);
+            return result;
+        }
+#if defined(__cpp_nontype_template_parameter_auto)
+        template <auto method, class Class>
+        static This bind(Class* pReceiver) CI0_NOEXCEPT(true)
+        {
+            This result;
+            result.template BaseInitMember<decltype(method), method>(pReceiver);
+            return result;
+        }
+#endif
     };
 
 }
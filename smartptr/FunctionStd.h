@@ -0,0 +1,63 @@
+#pragma once
+
+#include <functional>
+#include "Function.h"
+
+// Adapters between the ci0 function wrappers and std::function (and C++23 std::move_only_function).
+//
+// Storing one kind of wrapper in the other nests them: each call goes through both trampolines, and the inner wrapper
+// seldom fits in the outer one's small buffer, so it is allocated.  These adapters avoid both where they can.
+
+namespace ci0 {
+
+    // Returns a std::function that calls func's target through a FuncRef.  A FuncRef is two pointers and trivially copyable,
+    // which std::function stores in its small buffer in every mainstream implementation, so nothing is allocated.
+    // note: as with FuncRef, func's target must outlive the result.
+    //      std::function<void(int)> onResize = StdFunctionRef<void(int)>(m_onResize);
+    template <class TSig, class Func>
+    std::function<TSig> StdFunctionRef(const Func& func)
+    {
+        return std::function<TSig>(FuncRef<TSig>(func));
+    }
+
+    // Returns the ci0 wrapper held by stdFunc if its type is exactly Func (e.g. a Function that was passed through an API
+    // taking std::function), or else a Func holding stdFunc.
+    // note: std::function::target() compares typeid()s; without RTTI, stdFunc is always wrapped.
+    template <class Func, class TSig>
+    Func FromStdFunction(const std::function<TSig>& stdFunc)
+    {
+        if (const Func* pFunc = stdFunc.template target<Func>())
+        {
+            return *pFunc;
+        }
+        return Func(stdFunc);
+    }
+    template <class Func, class TSig>
+    Func FromStdFunction(std::function<TSig>&& stdFunc)
+    {
+        if (Func* pFunc = stdFunc.template target<Func>())
+        {
+            return Func(static_cast<Func&&>(*pFunc));
+        }
+        return Func(static_cast<std::function<TSig>&&>(stdFunc));
+    }
+
+    // A FixedFunction that holds any std::function<TSig> without allocating.
+    template <class TSig>
+    using StdFunctionHolder = FixedFunctionFor<TSig, std::function<TSig>>;
+
+#if defined(__cpp_lib_move_only_function)
+    // As StdFunctionRef, for std::move_only_function, which also takes const and noexcept signatures.
+    template <class TSig, class Func>
+    std::move_only_function<TSig> StdMoveOnlyFunctionRef(const Func& func)
+    {
+        return std::move_only_function<TSig>(FuncRef<TSig>(func));
+    }
+
+    // A UniqueFunction that holds any std::move_only_function<TSig> in its SBO, without allocating.
+    // note: std::move_only_function has no target(), so a ci0 wrapper inside one cannot be recovered.
+    template <class TSig>
+    using StdMoveOnlyFunctionHolder = UniqueFunction<TSig, sizeof(std::move_only_function<TSig>), alignof(std::move_only_function<TSig>)>;
+#endif
+
+}
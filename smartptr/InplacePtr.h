@@ -0,0 +1,384 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Noexcept.h"
+#include "ClonePtr.h"
+
+#if _MSC_VER
+#pragma warning(push)
+#pragma warning (disable : 4521) // "multiple copy constructors specified"
+#pragma warning (disable : 4522) // "multiple assignment operators specified"
+#endif
+
+namespace ci0 {
+
+    // InplacePtr is the move-only sibling of ClonePtr.
+    //  *   Objects that fit in the SBO (and are nothrow-move-constructible) are stored inline.
+    //  *   Larger or over-aligned objects fall back to the heap.
+    //  *   Only move construction is required of the Object; it is never copied.
+    //
+    // Prefer InplacePtr over UniquePtr for small polymorphic objects held in containers;
+    // it saves an allocation and a pointer indirection per object.
+    template <class Interface, size_t SboSize = sizeof(void*), size_t Align = ClonePtrDefaultAlign(SboSize)>
+    class InplacePtr
+    {
+    public:
+        typedef InplacePtr<Interface, SboSize, Align> This;
+
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign>
+        friend class InplacePtr;
+
+    private:
+        Interface* m_pInterface;
+        char* m_pObject;
+        const IClonePtrMover* m_pMover;
+        // note: SboSize=0 is legal; a 1-byte buffer is declared but never used
+        alignas(Align) char m_sbo[SboSize ? SboSize : 1];
+
+    private:
+        template <class Src, class Dst>
+        struct CastImplicit
+        {
+            typename std::remove_reference<Dst>::type* operator()(typename std::remove_reference<Src>::type* pSrc)
+            {
+                return pSrc;
+            }
+        };
+
+    private:
+        // deleted members
+        InplacePtr(const This& rhs);
+        InplacePtr(const This&& rhs);
+        InplacePtr(This& rhs);
+        This& operator=(const This& rhs);
+        This& operator=(const This&& rhs);
+        This& operator=(This& rhs);
+
+        // prevent naked delete from compiling; http://stackoverflow.com/a/3312507
+        struct PreventDelete;
+        operator PreventDelete*() const;
+
+    private:
+        // NOTE: Release() leaves m_pObject etc. pointing at a destructed object.
+        // Callers must subsequently call some Init*() function (except in ~InplacePtr).
+        void Release()
+        {
+            if (m_pInterface)
+            {
+                m_pMover->Destruct(m_pObject, m_sbo, SboSize);
+            }
+        }
+
+        void InitNull()
+        {
+            m_pInterface = nullptr;
+            m_pObject = nullptr;
+            m_pMover = nullptr;
+        }
+
+        // NOTE: InitMove*() are written out to produce clear error messages when
+        // incompatible types are assigned.  (see ClonePtr)
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign>
+        void InitMove_ImplicitCast(InplacePtr<RhsInterface, RhsSboSize, RhsAlign>&& rhs)
+        {
+            if (!rhs.m_pInterface)
+            {
+                InitNull();
+                return;
+            }
+
+            if (rhs.IsObjectInSboBuffer())
+            {
+                // we cannot steal the object pointer; the move-constructor must be invoked dynamically
+                m_pObject = rhs.m_pMover->Move(rhs.m_pObject, m_sbo, SboSize, Align);
+                m_pInterface = (RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject));
+                m_pMover = rhs.m_pMover;
+                rhs.m_pMover->Destruct(rhs.m_pObject, rhs.m_sbo, RhsSboSize);
+                rhs.InitNull();
+                return;
+            }
+
+            // steal the object pointer
+            m_pInterface = rhs.m_pInterface;
+            m_pObject = rhs.m_pObject;
+            m_pMover = rhs.m_pMover;
+            rhs.InitNull();
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign>
+        void InitMove_StaticCast(InplacePtr<RhsInterface, RhsSboSize, RhsAlign>&& rhs)
+        {
+            if (!rhs.m_pInterface)
+            {
+                InitNull();
+                return;
+            }
+
+            if (rhs.IsObjectInSboBuffer())
+            {
+                // we cannot steal the object pointer; the move-constructor must be invoked dynamically
+                m_pObject = rhs.m_pMover->Move(rhs.m_pObject, m_sbo, SboSize, Align);
+                m_pInterface = static_cast<Interface*>((RhsInterface*)(m_pObject + ((char*)rhs.m_pInterface - rhs.m_pObject)));
+                m_pMover = rhs.m_pMover;
+                rhs.m_pMover->Destruct(rhs.m_pObject, rhs.m_sbo, RhsSboSize);
+                rhs.InitNull();
+                return;
+            }
+
+            // steal the object pointer
+            m_pInterface = static_cast<Interface*>(rhs.m_pInterface);
+            m_pObject = rhs.m_pObject;
+            m_pMover = rhs.m_pMover;
+            rhs.InitNull();
+        }
+
+#if defined(__GNUC__)
+// Silence a spurious warning that an object is being placement-new'd into a too-small buffer; see ClonePtr.h.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wplacement-new"
+#endif
+        // Takes an Object that implements Interface, and move constructs it into
+        // the SBO or a new heap allocation.
+        template <class Object, class CastToInterface>
+        void AssignObjectValue(Object&& obj, CastToInterface&& castToInterface)
+        {
+            InitNull(); // reset members here, in case the constructor throws
+            typedef typename std::decay<Object>::type Obj;
+            if (ClonePtrFitsInSbo<Obj>(SboSize, Align))
+            {
+                Obj* pObject = new (m_sbo) Obj(std::forward<Object>(obj));
+                m_pInterface = castToInterface(pObject);
+                m_pObject = (char*)pObject;
+            }
+            else
+            {
+                Obj* pObject = ClonePtrHeap<Obj>::New(std::forward<Object>(obj));
+                m_pInterface = castToInterface(pObject);
+                m_pObject = (char*)pObject;
+            }
+            m_pMover = &ClonePtrMover<Obj>::Instance;
+        }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+        bool IsObjectInSboBuffer() const
+        {
+            bool result = uintptr_t(m_pObject - m_sbo) < SboSize;
+            return result;
+        }
+
+    public:
+        ~InplacePtr() CI0_NOEXCEPT(true)
+        {
+            Release();
+        }
+
+        InplacePtr() CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+        InplacePtr(nullptr_t) CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+
+        InplacePtr(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove_ImplicitCast(std::move(rhs));
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign>
+        InplacePtr(InplacePtr<RhsInterface, RhsSboSize, RhsAlign>&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove_ImplicitCast(std::move(rhs));
+        }
+
+        // Move a concrete object in.  (lvalues are rejected, since the Object may not be copyable)
+        template <class Object, class = typename std::enable_if<!std::is_lvalue_reference<Object>::value>::type>
+        explicit InplacePtr(Object&& obj)
+        {
+            AssignObjectValue(std::move(obj), CastImplicit<Object, Interface>());
+        }
+
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitMove_ImplicitCast(std::move(rhs));
+            }
+            return *this;
+        }
+        template <class RhsInterface, size_t RhsSboSize, size_t RhsAlign>
+        This& operator=(InplacePtr<RhsInterface, RhsSboSize, RhsAlign>&& rhs) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitMove_ImplicitCast(std::move(rhs));
+            return *this;
+        }
+        This& operator=(nullptr_t) CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitNull();
+            return *this;
+        }
+
+        // Move a concrete object in.
+        template <class Object, class = typename std::enable_if<!std::is_lvalue_reference<Object>::value>::type>
+        This& assign(Object&& obj)
+        {
+            Release();
+            AssignObjectValue(std::move(obj), CastImplicit<Object, Interface>());
+            return *this;
+        }
+
+        // Move a concrete object in.
+        // The CastToInterface() function-object argument can be used to disambiguate; see ClonePtr::assign().
+        template <class Object, class CastToInterface, class = typename std::enable_if<!std::is_lvalue_reference<Object>::value>::type>
+        This& assign(Object&& obj, CastToInterface&& castToInterface)
+        {
+            Release();
+            AssignObjectValue(std::move(obj), std::forward<CastToInterface>(castToInterface));
+            return *this;
+        }
+
+        // Takes ownership of pObject.  Allows initialization without moving.
+        //      InplacePtr<Base> pBase = InplacePtr<Base>().attach(new Derived(...));
+        template <class Object>
+        This& attach(Object* pObject) CI0_NOEXCEPT(true)
+        {
+            Release();
+            m_pObject = (char*)pObject;
+            m_pInterface = pObject;
+            m_pMover = &ClonePtrMover<Object>::Instance;
+            return *this;
+        }
+
+        This& swap(This& rhs) CI0_NOEXCEPT(true)
+        {
+            This tmp(std::move(rhs));
+            rhs = std::move(*this);
+            *this = std::move(tmp);
+            return *this;
+        }
+        This& swap(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            return swap(rhs);
+        }
+
+        This& reset() CI0_NOEXCEPT(true)
+        {
+            Release();
+            InitNull();
+            return *this;
+        }
+        // note: present for STL/boost compatibility, but you should prefer to call attach() instead
+        template <class Object>
+        This& reset(Object* pObject) CI0_NOEXCEPT(true)
+        {
+            return attach(pObject);
+        }
+
+        template <class RhsInterface, size_t RhsSboSize = sizeof(void*), size_t RhsAlign = ClonePtrDefaultAlign(RhsSboSize)>
+        InplacePtr<RhsInterface, RhsSboSize, RhsAlign> move_as() CI0_NOEXCEPT(true)
+        {
+            InplacePtr<RhsInterface, RhsSboSize, RhsAlign> pOther;
+            pOther.InitMove_StaticCast(std::move(*this));
+            return pOther;
+        }
+
+        Interface* const& get() const CI0_NOEXCEPT(true)
+        {
+            return m_pInterface;
+        }
+
+        Interface& operator*() const CI0_NOEXCEPT(true)
+        {
+            return *m_pInterface;
+        }
+        Interface* operator->() const CI0_NOEXCEPT(true)
+        {
+            return m_pInterface;
+        }
+
+        operator Interface*() const CI0_NOEXCEPT(true)
+        {
+            return m_pInterface;
+        }
+        explicit operator bool() const CI0_NOEXCEPT(true)
+        {
+            return !!m_pInterface;
+        }
+        template <class Type>
+        explicit operator Type*() const CI0_NOEXCEPT(true)
+        {
+            return static_cast<Type*>(m_pInterface);
+        }
+    };
+
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class RhsObject, size_t RhsSboSize, size_t RhsAlign>
+    inline bool operator==(const InplacePtr<LhsObject, LhsSboSize, LhsAlign>& lhs, const InplacePtr<RhsObject, RhsSboSize, RhsAlign>& rhs)
+    {
+        return lhs.get() == rhs.get();
+    }
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class RhsObject, size_t RhsSboSize, size_t RhsAlign>
+    inline bool operator!=(const InplacePtr<LhsObject, LhsSboSize, LhsAlign>& lhs, const InplacePtr<RhsObject, RhsSboSize, RhsAlign>& rhs)
+    {
+        return lhs.get() != rhs.get();
+    }
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class RhsObject, size_t RhsSboSize, size_t RhsAlign>
+    inline bool operator>=(const InplacePtr<LhsObject, LhsSboSize, LhsAlign>& lhs, const InplacePtr<RhsObject, RhsSboSize, RhsAlign>& rhs)
+    {
+        return lhs.get() >= rhs.get();
+    }
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class RhsObject, size_t RhsSboSize, size_t RhsAlign>
+    inline bool operator<=(const InplacePtr<LhsObject, LhsSboSize, LhsAlign>& lhs, const InplacePtr<RhsObject, RhsSboSize, RhsAlign>& rhs)
+    {
+        return lhs.get() <= rhs.get();
+    }
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class RhsObject, size_t RhsSboSize, size_t RhsAlign>
+    inline bool operator>(const InplacePtr<LhsObject, LhsSboSize, LhsAlign>& lhs, const InplacePtr<RhsObject, RhsSboSize, RhsAlign>& rhs)
+    {
+        return lhs.get() > rhs.get();
+    }
+    template <class LhsObject, size_t LhsSboSize, size_t LhsAlign, class RhsObject, size_t RhsSboSize, size_t RhsAlign>
+    inline bool operator<(const InplacePtr<LhsObject, LhsSboSize, LhsAlign>& lhs, const InplacePtr<RhsObject, RhsSboSize, RhsAlign>& rhs)
+    {
+        return lhs.get() < rhs.get();
+    }
+
+    template <class Object, size_t SboSize, size_t Align>
+    inline bool operator==(const InplacePtr<Object, SboSize, Align>& lhs, std::nullptr_t)
+    {
+        return lhs.get() == nullptr;
+    }
+    template <class Object, size_t SboSize, size_t Align>
+    inline bool operator==(std::nullptr_t, const InplacePtr<Object, SboSize, Align>& rhs)
+    {
+        return nullptr == rhs.get();
+    }
+    template <class Object, size_t SboSize, size_t Align>
+    inline bool operator!=(const InplacePtr<Object, SboSize, Align>& lhs, std::nullptr_t)
+    {
+        return lhs.get() != nullptr;
+    }
+    template <class Object, size_t SboSize, size_t Align>
+    inline bool operator!=(std::nullptr_t, const InplacePtr<Object, SboSize, Align>& rhs)
+    {
+        return nullptr != rhs.get();
+    }
+
+    template <class Object, size_t SboSize, size_t Align>
+    void swap(InplacePtr<Object, SboSize, Align>& lhs, InplacePtr<Object, SboSize, Align>& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#if _MSC_VER
+#pragma warning(pop)
+#endif
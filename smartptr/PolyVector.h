@@ -0,0 +1,447 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Noexcept.h"
+#include "ClonePtr.h"
+
+namespace ci0 {
+
+    // PolyVector stores objects of different concrete types that implement Interface,
+    // packed back-to-back in a single growing buffer (unlike std::vector<ClonePtr<Interface, 0>>,
+    // which scatters every object in its own heap allocation).
+    //  *   Iteration yields Interface&, in insertion order.
+    //  *   for_each_grouped() visits objects grouped by concrete type, so that consecutive virtual calls
+    //      hit the same target; this helps the branch predictor when types are interleaved.
+    //  *   Copying a PolyVector clones every object, through the same cloners as ClonePtr.
+    //
+    // Objects must be nothrow-move-constructible, since growing the buffer relocates them.
+    // Like std::vector, growth invalidates references to the objects.
+    template <class Interface>
+    class PolyVector
+    {
+    public:
+        typedef PolyVector<Interface> This;
+
+    private:
+        struct Entry
+        {
+            Interface* pInterface;
+            const IClonePtrCloner* pCloner;
+            size_t offset;
+        };
+
+        template <class Value, class EntryPtr>
+        class Iter
+        {
+        public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef Value value_type;
+            typedef ptrdiff_t difference_type;
+            typedef Value* pointer;
+            typedef Value& reference;
+
+        private:
+            EntryPtr m_pEntry;
+
+        public:
+            Iter() : m_pEntry() {}
+            explicit Iter(EntryPtr pEntry) : m_pEntry(pEntry) {}
+
+            Value& operator*() const { return *m_pEntry->pInterface; }
+            Value* operator->() const { return m_pEntry->pInterface; }
+            Value& operator[](ptrdiff_t n) const { return *m_pEntry[n].pInterface; }
+
+            Iter& operator++() { ++m_pEntry; return *this; }
+            Iter& operator--() { --m_pEntry; return *this; }
+            Iter operator++(int) { Iter result = *this; ++m_pEntry; return result; }
+            Iter operator--(int) { Iter result = *this; --m_pEntry; return result; }
+            Iter& operator+=(ptrdiff_t n) { m_pEntry += n; return *this; }
+            Iter& operator-=(ptrdiff_t n) { m_pEntry -= n; return *this; }
+            Iter operator+(ptrdiff_t n) const { return Iter(m_pEntry + n); }
+            Iter operator-(ptrdiff_t n) const { return Iter(m_pEntry - n); }
+            ptrdiff_t operator-(const Iter& rhs) const { return m_pEntry - rhs.m_pEntry; }
+
+            bool operator==(const Iter& rhs) const { return m_pEntry == rhs.m_pEntry; }
+            bool operator!=(const Iter& rhs) const { return m_pEntry != rhs.m_pEntry; }
+            bool operator<(const Iter& rhs) const { return m_pEntry < rhs.m_pEntry; }
+            bool operator>(const Iter& rhs) const { return m_pEntry > rhs.m_pEntry; }
+            bool operator<=(const Iter& rhs) const { return m_pEntry <= rhs.m_pEntry; }
+            bool operator>=(const Iter& rhs) const { return m_pEntry >= rhs.m_pEntry; }
+        };
+
+    public:
+        typedef Iter<Interface, Entry*> iterator;
+        typedef Iter<const Interface, const Entry*> const_iterator;
+
+    private:
+        char* m_pBuffer;
+        size_t m_usedBytes;
+        size_t m_capacityBytes;
+        std::vector<Entry> m_entries;
+        // Cached visitation order for the non-const for_each_grouped(); empty when stale.
+        std::vector<size_t> m_groupedOrder;
+
+    private:
+        static size_t AlignUp(size_t offset, size_t align)
+        {
+            return (offset + align - 1) & ~(align - 1);
+        }
+
+        static char* Allocate(size_t bytes)
+        {
+            return bytes ? (char*)::operator new(bytes) : nullptr;
+        }
+
+        void Release()
+        {
+            for (size_t i = m_entries.size(); i-- > 0; )
+            {
+                const Entry& entry = m_entries[i];
+                if (!entry.pCloner->isTriviallyDestructible)
+                {
+                    entry.pCloner->pDestroyInPlace(m_pBuffer + entry.offset);
+                }
+            }
+            ::operator delete(m_pBuffer);
+        }
+
+        void InitNull()
+        {
+            m_pBuffer = nullptr;
+            m_usedBytes = 0;
+            m_capacityBytes = 0;
+            m_entries.clear();
+            m_groupedOrder.clear();
+        }
+
+        void InitCopy(const This& rhs)
+        {
+            InitNull(); // reset members here, in case a Copy() throws
+            m_entries.reserve(rhs.m_entries.size());
+            m_pBuffer = Allocate(rhs.m_usedBytes);
+            m_capacityBytes = rhs.m_usedBytes;
+            try
+            {
+                for (const Entry& rhsEntry : rhs.m_entries)
+                {
+                    const IClonePtrCloner* pCloner = rhsEntry.pCloner;
+                    const char* pRhsObject = rhs.m_pBuffer + rhsEntry.offset;
+                    char* pObject = pCloner->Copy(pRhsObject, m_pBuffer + rhsEntry.offset, pCloner->sizeofObject, pCloner->alignofObject);
+                    Entry entry = { (Interface*)(pObject + ((char*)rhsEntry.pInterface - pRhsObject)), pCloner, rhsEntry.offset };
+                    m_entries.push_back(entry);
+                }
+            }
+            catch (...)
+            {
+                Release();
+                InitNull();
+                throw;
+            }
+            m_usedBytes = rhs.m_usedBytes;
+        }
+
+        void InitMove(This&& rhs)
+        {
+            m_pBuffer = rhs.m_pBuffer;
+            m_usedBytes = rhs.m_usedBytes;
+            m_capacityBytes = rhs.m_capacityBytes;
+            m_entries = std::move(rhs.m_entries);
+            m_groupedOrder = std::move(rhs.m_groupedOrder);
+            rhs.InitNull();
+        }
+
+        // Moves all objects into a new buffer of (at least) newCapacityBytes, keeping their offsets.
+        void Reallocate(size_t newCapacityBytes)
+        {
+            RelocateTo(Allocate(newCapacityBytes), newCapacityBytes);
+        }
+        void RelocateTo(char* pNewBuffer, size_t newCapacityBytes)
+        {
+            for (Entry& entry : m_entries)
+            {
+                const IClonePtrCloner* pCloner = entry.pCloner;
+                char* pOldObject = m_pBuffer + entry.offset;
+                char* pNewObject = pNewBuffer + entry.offset;
+                ptrdiff_t interfaceOffset = (char*)entry.pInterface - pOldObject;
+                if (pCloner->isTriviallyRelocatable)
+                {
+                    memcpy(pNewObject, pOldObject, pCloner->sizeofObject);
+                }
+                else
+                {
+                    // the destination is sized and aligned for the object, so Move() constructs it there (noexcept)
+                    pCloner->Move(pOldObject, pNewObject, pCloner->sizeofObject, pCloner->alignofObject);
+                    if (!pCloner->isTriviallyDestructible)
+                    {
+                        pCloner->pDestroyInPlace(pOldObject);
+                    }
+                }
+                entry.pInterface = (Interface*)(pNewObject + interfaceOffset);
+            }
+            ::operator delete(m_pBuffer);
+            m_pBuffer = pNewBuffer;
+            m_capacityBytes = newCapacityBytes;
+        }
+
+        size_t GrownCapacity(size_t requiredBytes) const
+        {
+            size_t newCapacityBytes = std::max(m_capacityBytes * 2, requiredBytes);
+            return std::max(newCapacityBytes, size_t(64));
+        }
+
+        template <class Object, class CastToInterface, class... Args>
+        Object& EmplaceObject(CastToInterface&& castToInterface, Args&&... args)
+        {
+            static_assert(std::is_nothrow_move_constructible<Object>::value, "PolyVector relocates objects when it grows; Object must be nothrow-move-constructible");
+            static_assert(alignof(Object) <= alignof(std::max_align_t), "PolyVector does not support over-aligned objects");
+
+            if (m_entries.size() == m_entries.capacity())
+            {
+                m_entries.reserve(std::max(m_entries.size() * 2, size_t(8))); // so that push_back() below cannot throw
+            }
+            size_t offset = AlignUp(m_usedBytes, alignof(Object));
+            Object* pObject;
+            if (offset + sizeof(Object) <= m_capacityBytes)
+            {
+                pObject = new (m_pBuffer + offset) Object(std::forward<Args>(args)...);
+            }
+            else
+            {
+                // Construct the new object before relocating the others, since args may refer to one of them
+                // (e.g. v.push_back(*v.as<Derived>(0))), as std::vector allows.
+                size_t newCapacityBytes = GrownCapacity(offset + sizeof(Object));
+                char* pNewBuffer = Allocate(newCapacityBytes);
+                try
+                {
+                    pObject = new (pNewBuffer + offset) Object(std::forward<Args>(args)...);
+                }
+                catch (...)
+                {
+                    ::operator delete(pNewBuffer);
+                    throw;
+                }
+                RelocateTo(pNewBuffer, newCapacityBytes);
+            }
+            Entry entry = { castToInterface(pObject), &ClonePtrCloner<Object>::Instance, offset };
+            m_entries.push_back(entry);
+            m_usedBytes = offset + sizeof(Object);
+            m_groupedOrder.clear();
+            return *pObject;
+        }
+
+        template <class Src, class Dst>
+        struct CastImplicit
+        {
+            typename std::remove_reference<Dst>::type* operator()(typename std::remove_reference<Src>::type* pSrc)
+            {
+                return pSrc;
+            }
+        };
+
+        void BuildGroupedOrder(std::vector<size_t>& order) const
+        {
+            order.resize(m_entries.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+            const Entry* pEntries = m_entries.data();
+            std::stable_sort(order.begin(), order.end(), [pEntries](size_t lhs, size_t rhs) {
+                return std::less<const IClonePtrCloner*>()(pEntries[lhs].pCloner, pEntries[rhs].pCloner);
+            });
+        }
+
+    public:
+        ~PolyVector() CI0_NOEXCEPT(true)
+        {
+            Release();
+        }
+
+        PolyVector() CI0_NOEXCEPT(true)
+        {
+            InitNull();
+        }
+
+        PolyVector(const This& rhs)
+        {
+            InitCopy(rhs);
+        }
+        PolyVector(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            InitMove(std::move(rhs));
+        }
+
+        This& operator=(const This& rhs)
+        {
+            if (this != &rhs)
+            {
+                This other(rhs);
+                Release();
+                InitMove(std::move(other));
+            }
+            return *this;
+        }
+        This& operator=(This&& rhs) CI0_NOEXCEPT(true)
+        {
+            if (this != &rhs)
+            {
+                Release();
+                InitMove(std::move(rhs));
+            }
+            return *this;
+        }
+
+        // Copy or move a concrete object in.
+        template <class Object>
+        typename std::decay<Object>::type& push_back(Object&& obj)
+        {
+            typedef typename std::decay<Object>::type Obj;
+            return EmplaceObject<Obj>(CastImplicit<Obj, Interface>(), std::forward<Object>(obj));
+        }
+
+        // Constructs an Object in-place at the end, from args.
+        //      shapes.emplace_back<Circle>(1.0f);
+        template <class Object, class... Args>
+        Object& emplace_back(Args&&... args)
+        {
+            return EmplaceObject<Object>(CastImplicit<Object, Interface>(), std::forward<Args>(args)...);
+        }
+
+        void pop_back() CI0_NOEXCEPT(true)
+        {
+            assert(!m_entries.empty());
+            const Entry& entry = m_entries.back();
+            if (!entry.pCloner->isTriviallyDestructible)
+            {
+                entry.pCloner->pDestroyInPlace(m_pBuffer + entry.offset);
+            }
+            m_usedBytes = entry.offset;
+            m_entries.pop_back();
+            m_groupedOrder.clear();
+        }
+
+        void clear() CI0_NOEXCEPT(true)
+        {
+            while (!m_entries.empty())
+            {
+                pop_back();
+            }
+            m_usedBytes = 0;
+        }
+
+        // Reserves room for count more entries, and bytes more bytes of object storage.
+        void reserve(size_t count, size_t bytes)
+        {
+            m_entries.reserve(m_entries.size() + count);
+            if (m_usedBytes + bytes > m_capacityBytes)
+            {
+                Reallocate(m_usedBytes + bytes);
+            }
+        }
+
+        This& swap(This& rhs) CI0_NOEXCEPT(true)
+        {
+            std::swap(m_pBuffer, rhs.m_pBuffer);
+            std::swap(m_usedBytes, rhs.m_usedBytes);
+            std::swap(m_capacityBytes, rhs.m_capacityBytes);
+            m_entries.swap(rhs.m_entries);
+            m_groupedOrder.swap(rhs.m_groupedOrder);
+            return *this;
+        }
+
+        size_t size() const CI0_NOEXCEPT(true)
+        {
+            return m_entries.size();
+        }
+        bool empty() const CI0_NOEXCEPT(true)
+        {
+            return m_entries.empty();
+        }
+        // Bytes of object storage in use, including alignment padding.
+        size_t size_bytes() const CI0_NOEXCEPT(true)
+        {
+            return m_usedBytes;
+        }
+
+        Interface& operator[](size_t index) CI0_NOEXCEPT(true)
+        {
+            return *m_entries[index].pInterface;
+        }
+        const Interface& operator[](size_t index) const CI0_NOEXCEPT(true)
+        {
+            return *m_entries[index].pInterface;
+        }
+
+        // Exact-type test and cast of one element; see ClonePtr::is().
+        template <class Object>
+        bool is(size_t index) const CI0_NOEXCEPT(true)
+        {
+            return m_entries[index].pCloner == &ClonePtrCloner<Object>::Instance;
+        }
+        template <class Object>
+        Object* as(size_t index) CI0_NOEXCEPT(true)
+        {
+            return is<Object>(index) ? (Object*)(m_pBuffer + m_entries[index].offset) : nullptr;
+        }
+        template <class Object>
+        const Object* as(size_t index) const CI0_NOEXCEPT(true)
+        {
+            return is<Object>(index) ? (const Object*)(m_pBuffer + m_entries[index].offset) : nullptr;
+        }
+
+        iterator begin() CI0_NOEXCEPT(true) { return iterator(m_entries.data()); }
+        iterator end() CI0_NOEXCEPT(true) { return iterator(m_entries.data() + m_entries.size()); }
+        const_iterator begin() const CI0_NOEXCEPT(true) { return const_iterator(m_entries.data()); }
+        const_iterator end() const CI0_NOEXCEPT(true) { return const_iterator(m_entries.data() + m_entries.size()); }
+
+        // Calls fn(Interface&) on every object, with objects of the same concrete type visited consecutively
+        // (in insertion order within each type).  The visitation order is cached until the next modification.
+        template <class Fn>
+        void for_each_grouped(Fn&& fn)
+        {
+            if (m_groupedOrder.size() != m_entries.size())
+            {
+                BuildGroupedOrder(m_groupedOrder);
+            }
+            const Entry* pEntries = m_entries.data();
+            for (size_t index : m_groupedOrder)
+            {
+                fn(*pEntries[index].pInterface);
+            }
+        }
+        // note: uses the cached order if it is current, but never writes it, so that concurrent const calls are safe;
+        // otherwise the order is built for this call only.
+        template <class Fn>
+        void for_each_grouped(Fn&& fn) const
+        {
+            std::vector<size_t> localOrder;
+            const std::vector<size_t>* pOrder = &m_groupedOrder;
+            if (m_groupedOrder.size() != m_entries.size())
+            {
+                BuildGroupedOrder(localOrder);
+                pOrder = &localOrder;
+            }
+            const Entry* pEntries = m_entries.data();
+            for (size_t index : *pOrder)
+            {
+                fn(*(const Interface*)pEntries[index].pInterface);
+            }
+        }
+    };
+
+    template <class Interface>
+    void swap(PolyVector<Interface>& lhs, PolyVector<Interface>& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
@@ -1,12 +1,29 @@
+#define FUNCTION_ENABLE_DEBUG 1 // opt in, so that TestFunctionDebug() covers the registry
+
 #include "UniquePtr.h"
 #include "ClonePtr.h"
+#include "ClonePtrPool.h"
+#include "InplacePtr.h"
 #include "IntrusivePtr.h"
+#include "CowPtr.h"
+#include "PolyVector.h"
+#include "ClosedPolyPtr.h"
 #include "Function.h"
+#include "FunctionStd.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
 #include <utility>
 #include <functional>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
 
 #define ENABLE_MISUSE 0
+#define ENABLE_BENCHMARKS 0
 
 void UseIntPtr(int* pInt)
 {
@@ -103,8 +120,15 @@ void TestUniquePtr()
     }
 }
 
+// Cloner tables are constant-initialized, so ClonePtrs can be created by other globals' dynamic initializers.
+static ci0::ClonePtr<Base> s_pGlobalBase = ci0::MakeClone<Base, Derived>(1, 2);
+
 void TestClonePtr()
 {
+    {
+        ci0::ClonePtr<Base> pBase = s_pGlobalBase;
+        assert(pBase->foo == 1 && ((Derived*)pBase)->bar == 2);
+    }
     {
         Derived der(3, 4);
         ci0::ClonePtr<Base> pBase1(der);
@@ -163,6 +187,398 @@ void TestClonePtr()
     }
 }
 
+// vtable pointers are safe to memcpy, so this is trivially relocatable despite being polymorphic
+struct RelocatableDerived : Base
+{
+    RelocatableDerived(int foo_) { foo = foo_; }
+};
+namespace ci0 {
+    template <> struct IsTriviallyRelocatable<RelocatableDerived> : std::true_type {};
+}
+struct CountedDerived : Base
+{
+    static int s_liveCount;
+    static int s_copyCount;
+
+    ~CountedDerived() { s_liveCount -= 1; }
+    CountedDerived(int foo_) { foo = foo_; s_liveCount += 1; }
+    CountedDerived(const CountedDerived& rhs) CI0_NOEXCEPT(true) { foo = rhs.foo; s_liveCount += 1; s_copyCount += 1; }
+    CountedDerived& operator=(const CountedDerived& rhs) CI0_NOEXCEPT(true) { foo = rhs.foo; return *this; }
+};
+int CountedDerived::s_liveCount = 0;
+int CountedDerived::s_copyCount = 0;
+struct BigCountedDerived final : CountedDerived
+{
+    char padding[32] = {};
+
+    BigCountedDerived(int foo_) : CountedDerived(foo_) {}
+};
+
+// A heap object's address is kept inside the SBO, so ClonePtr needs no separate object pointer.
+static_assert(sizeof(ci0::ClonePtr<Base>) == 3 * sizeof(void*), "unexpected ClonePtr size");
+static_assert(sizeof(ci0::ClonePtr<Base, 0>) == 3 * sizeof(void*), "unexpected ClonePtr size");
+static_assert(sizeof(ci0::ClonePtr<Base, 2 * sizeof(void*)>) == 4 * sizeof(void*), "unexpected ClonePtr size");
+
+void TestClonePtrRelocation()
+{
+    typedef ci0::ClonePtr<Base, 16> BasePtr16;
+    {
+        // mix of trivially relocatable SBO objects, non-trivial SBO objects, and heap objects
+        std::vector<BasePtr16> ptrs;
+        for (int i = 0; i < 30; ++i)
+        {
+            int foo = (i * 7) % 30;
+            switch (i % 3)
+            {
+            case 0: ptrs.push_back(BasePtr16(RelocatableDerived(foo))); break;
+            case 1: ptrs.push_back(BasePtr16(CountedDerived(foo))); break;
+            case 2: ptrs.push_back(BasePtr16(BigCountedDerived(foo))); break;
+            }
+        }
+        ptrs.push_back(BasePtr16());
+        std::sort(ptrs.begin(), ptrs.end(),
+            [](const BasePtr16& lhs, const BasePtr16& rhs)
+            {
+                return (lhs ? lhs->foo : -1) < (rhs ? rhs->foo : -1);
+            });
+        bool sorted = !ptrs[0];
+        for (int i = 1; i <= 30; ++i)
+        {
+            sorted = sorted && (ptrs[i]->foo == i - 1);
+        }
+        printf("sorted=%d liveCount=%d\n", sorted, CountedDerived::s_liveCount);
+        assert(sorted && CountedDerived::s_liveCount == 20);
+
+        // the four {sbo, !sbo}x{rhsSbo, !rhsSbo} swap() cases, plus null
+        BasePtr16 pReloc(RelocatableDerived(1)), pCounted(CountedDerived(2)), pBig(BigCountedDerived(3)), pBig2(BigCountedDerived(4)), pNull;
+        pReloc.swap(pCounted);  // sbo/sbo
+        pReloc.swap(pBig);      // sbo/heap
+        pBig.swap(pBig2);       // heap/heap
+        pNull.swap(pReloc);     // heap(null)/sbo
+        swap(pBig, pCounted);   // sbo/sbo via ADL
+        printf("swapped: %d %d %d %d %d\n", pReloc ? pReloc->foo : -1, pCounted->foo, pBig->foo, pBig2->foo, pNull->foo);
+        assert(!pReloc && pCounted->foo == 4 && pBig->foo == 1 && pBig2->foo == 2 && pNull->foo == 3);
+    }
+    printf("liveCount=%d\n", CountedDerived::s_liveCount);
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+
+void TestClonePtrCopyAssign()
+{
+    typedef ci0::ClonePtr<Base, 16> BasePtr16;
+    {
+        BasePtr16 pSmall1(CountedDerived(1)), pSmall2(CountedDerived(2));
+        BasePtr16 pBig1(BigCountedDerived(3)), pBig2(BigCountedDerived(4));
+        Base* pSmallOld = pSmall1;
+        Base* pBigOld = pBig1;
+        int copyCount = CountedDerived::s_copyCount;
+
+        // same concrete type: assigned in-place, no copy-construction and no reallocation
+        pSmall1 = pSmall2;
+        pBig1 = pBig2;
+        printf("in-place: copies=%d sameSmall=%d sameBig=%d foo=%d,%d\n",
+            CountedDerived::s_copyCount - copyCount, pSmall1 == pSmallOld, pBig1 == pBigOld, pSmall1->foo, pBig1->foo);
+        assert(CountedDerived::s_copyCount == copyCount && pSmall1 == pSmallOld && pBig1 == pBigOld);
+        assert(pSmall1->foo == 2 && pBig1->foo == 4);
+
+        // different concrete types: copy-then-move
+        pSmall1 = pBig2;
+        printf("copy-then-move: copies=%d foo=%d\n", CountedDerived::s_copyCount - copyCount, pSmall1->foo);
+        assert(CountedDerived::s_copyCount == copyCount + 1 && pSmall1->foo == 4);
+    }
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+
+// A bump allocator that counts its traffic; memory is only reclaimed when the arena goes away.
+struct CountingArena
+{
+    alignas(std::max_align_t) char buffer[1024];
+    size_t used = 0;
+    int allocCount = 0;
+    int freeCount = 0;
+
+    void* allocate(size_t size, size_t align)
+    {
+        used = (used + align - 1) & ~(align - 1);
+        void* p = buffer + used;
+        used += size;
+        assert(used <= sizeof(buffer));
+        allocCount += 1;
+        return p;
+    }
+    void deallocate(void* p, size_t, size_t)
+    {
+        assert((char*)p >= buffer && (char*)p < buffer + sizeof(buffer));
+        (void)p;
+        freeCount += 1;
+    }
+};
+
+int Negate(int x)
+{
+    return -x;
+}
+
+void TestAllocator()
+{
+    typedef ci0::ClonePtrResourceAllocator<CountingArena> ArenaAlloc;
+    typedef ci0::ClonePtr<Base, 16, 8, ArenaAlloc> ArenaBasePtr;
+    static_assert(sizeof(ArenaBasePtr) == sizeof(ci0::ClonePtr<Base, 16, 8>) + sizeof(void*), "a stateful allocator costs one pointer");
+    static_assert(sizeof(ci0::ClonePtr<Base, 16, 8, ci0::ClonePtrNewDelete>) == sizeof(ci0::ClonePtr<Base, 16, 8>), "the default allocator is free");
+
+    CountingArena arena, arena2;
+    {
+        // only objects that do not fit in the SBO are allocated from the arena
+        ArenaBasePtr pBig = ci0::AllocateClone<Base, BigCountedDerived, 16, 8>(ArenaAlloc(&arena), 1);
+        ArenaBasePtr pSmall(std::allocator_arg, ArenaAlloc(&arena));
+        pSmall.emplace<CountedDerived>(2);
+        assert(arena.allocCount == 1 && pBig->foo == 1 && pSmall->foo == 2);
+
+        // copies share the arena; copy-assignment keeps the destination's
+        ArenaBasePtr pCopy = pBig;
+        ArenaBasePtr pCopy2(std::allocator_arg, ArenaAlloc(&arena2));
+        pCopy2 = pBig;
+        assert(arena.allocCount == 2 && arena2.allocCount == 1);
+        assert(pCopy.get_allocator().pResource == &arena && pCopy2.get_allocator().pResource == &arena2);
+
+        // moves take the arena along, so the object is never copied
+        Base* pOld = pCopy2;
+        ArenaBasePtr pMoved = std::move(pCopy2);
+        pCopy = std::move(pMoved);
+        assert(pCopy == pOld && pCopy.get_allocator().pResource == &arena2 && arena.freeCount == 1);
+
+        // swapping holders with different arenas swaps the arenas too
+        pBig.swap(pCopy);
+        assert(pBig == pOld && pBig.get_allocator().pResource == &arena2 && pCopy.get_allocator().pResource == &arena);
+
+        // a holder with a different Alloc type cannot free arena memory, so the object is relocated
+        ci0::ClonePtr<Base, 16, 8> pHeap = std::move(pBig);
+        assert(!pBig && pHeap->foo == 1 && arena2.freeCount == 1);
+        printf("arena: allocs=%d frees=%d, arena2: allocs=%d frees=%d\n", arena.allocCount, arena.freeCount, arena2.allocCount, arena2.freeCount);
+
+        // Function's heap fallback uses the same policies
+        int values[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        ci0::Function<int(int), sizeof(void*), alignof(std::max_align_t), ArenaAlloc> fn(std::allocator_arg, ArenaAlloc(&arena));
+        fn = [values](int i) { return values[i]; };
+        auto fnCopy = fn;
+        assert(fn(3) == 4 && fnCopy(7) == 8 && arena.allocCount == 4);
+
+        // a raw function pointer owns nothing, so it moves between allocators without relocation
+        ci0::Function<int(int), sizeof(void*), alignof(std::max_align_t), ArenaAlloc> rawFn(std::allocator_arg, ArenaAlloc(&arena2));
+        rawFn = &Negate;
+        fn = std::move(rawFn);
+        assert(fn(1) == -1 && !rawFn);
+    }
+    assert(arena.allocCount == arena.freeCount && arena2.allocCount == arena2.freeCount);
+    assert(CountedDerived::s_liveCount == 0);
+
+#if CI0_HAS_MEMORY_RESOURCE
+    {
+        // with std::pmr, copies use the default resource, as with std::pmr::polymorphic_allocator
+        char buffer[256];
+        std::pmr::monotonic_buffer_resource mono(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        typedef ci0::ClonePtr<Base, 16, 8, ci0::ClonePtrPmrAllocator> PmrBasePtr;
+        PmrBasePtr pBig = ci0::AllocateClone<Base, BigCountedDerived, 16, 8>(ci0::ClonePtrPmrAllocator(&mono), 3);
+        PmrBasePtr pCopy = pBig;
+        assert((char*)pBig.get() >= buffer && (char*)pBig.get() < buffer + sizeof(buffer));
+        assert(pCopy.get_allocator().pResource == std::pmr::get_default_resource() && pCopy->foo == 3);
+    }
+    assert(CountedDerived::s_liveCount == 0);
+#endif
+}
+
+void TestClonePtrPool()
+{
+    typedef ci0::ClonePtr<Base, sizeof(void*), alignof(void*), ci0::ClonePtrPoolAllocator> PooledBasePtr;
+    {
+        // freed blocks are reused by the next allocation of the same size class
+        PooledBasePtr pA(BigCountedDerived(1));
+        Base* pOld = pA;
+        pA.reset();
+        pA.emplace<BigCountedDerived>(2);
+        PooledBasePtr pB = pA;
+        printf("pool: reused=%d\n", pA == pOld);
+        assert(pA == pOld && pB != pOld && pB->foo == 2);
+        assert(ci0::ClonePtrPool::Fits(sizeof(BigCountedDerived)) && !ci0::ClonePtrPool::Fits(ci0::ClonePtrPool::MaxBlockSize + 1));
+
+        // blocks may be freed by any thread; they return to the cache of the thread that allocated them
+        Base* pFromThread = nullptr;
+        std::thread([&] { pB.emplace<BigCountedDerived>(3); pFromThread = pB; }).join();
+        pB.reset();
+        Base* pAdopted = nullptr;
+        std::thread([&] { PooledBasePtr pC(BigCountedDerived(4)); pAdopted = pC; }).join();
+        printf("pool: returned across threads=%d\n", pAdopted == pFromThread);
+        assert(pAdopted == pFromThread);
+
+        // objects too big for the pool fall back to operator new
+        struct Huge : Base { char payload[ci0::ClonePtrPool::MaxBlockSize]; };
+        PooledBasePtr pHuge(Huge{});
+        PooledBasePtr pHugeCopy = pHuge;
+
+        ci0::Function<int(int), sizeof(void*), alignof(std::max_align_t), ci0::ClonePtrPoolAllocator> fn;
+        int values[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        fn = [values](int i) { return values[i]; };
+        assert(fn(5) == 6);
+    }
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+void TestOwnershipTransfer()
+{
+    {
+        // heap objects change hands without a copy, in both directions
+        int copyCount = CountedDerived::s_copyCount;
+        ci0::ClonePtr<Base> pHeap(ci0::MakeUnique<BigCountedDerived>(1));
+        Base* pOld = pHeap;
+        ci0::UniquePtr<Base> pUnique = pHeap.release_to_unique();
+        assert(!pHeap && pUnique == pOld);
+        ci0::ClonePtr<Base, 0> pClone0;
+        pClone0 = ci0::MakeUnique<BigCountedDerived>(2);
+        ci0::UniquePtr<BigCountedDerived> pUnique0 = pClone0.release_to_unique<BigCountedDerived>();
+        assert(!pClone0 && pUnique0->foo == 2);
+        printf("release_to_unique: copies=%d\n", CountedDerived::s_copyCount - copyCount);
+        assert(CountedDerived::s_copyCount == copyCount);
+
+        // objects in the SBO are relocated to the heap
+        ci0::ClonePtr<Base, 16> pSbo(CountedDerived(3));
+        ci0::UniquePtr<Base> pUnique16 = pSbo.release_to_unique();
+        assert(!pSbo && pUnique16->foo == 3 && CountedDerived::s_liveCount == 3);
+
+        ci0::ClonePtr<Base> pNull(ci0::UniquePtr<BigCountedDerived>{});
+        assert(!pNull && !pNull.release_to_unique());
+
+#if ENABLE_MISUSE
+        // a UniquePtr<Base> may hold any derived object, whose cloner is unknown; copies would slice it
+        ci0::ClonePtr<Base> pSliced(ci0::UniquePtr<Base>(new Derived(1, 2)));    // misuse causes compile error: adopt only a UniquePtr to the final (concrete) type
+        pNull = ci0::UniquePtr<Base>(new Derived(1, 2));                       // misuse causes compile error: adopt only a UniquePtr to the final (concrete) type
+#endif
+    }
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+
+template <size_t N>
+struct alignas(N) AlignedDerived : Base
+{
+    char payload[N] = {};
+
+    AlignedDerived(int foo_) { foo = foo_; }
+};
+
+bool IsAligned(const void* p, size_t align)
+{
+    return (uintptr_t(p) % align) == 0;
+}
+
+// Checks that the Object lands on a properly aligned address in every storage location
+// (SBO or heap) that copy, move and assignment can send it to.
+template <class Object, size_t SboSize, size_t Align>
+void TestClonePtrAlignment()
+{
+    typedef ci0::ClonePtr<Base, SboSize, Align> BasePtr;
+    BasePtr pBase1(Object(1));
+    BasePtr pBase2 = pBase1;
+    BasePtr pBase3 = std::move(pBase2);
+    ci0::ClonePtr<Base, 0> pBase4 = pBase3;
+    pBase2 = std::move(pBase4);
+    bool aligned =
+        IsAligned((Object*)pBase1, alignof(Object)) &&
+        IsAligned((Object*)pBase2, alignof(Object)) &&
+        IsAligned((Object*)pBase3, alignof(Object));
+    printf("ClonePtr<Base, %2u, %2u> holding align=%2u object: aligned=%d\n",
+        unsigned(SboSize), unsigned(Align), unsigned(alignof(Object)), aligned);
+    assert(aligned);
+}
+
+template <size_t ObjAlign, size_t SboSize, size_t Align>
+void TestFunctionAlignment()
+{
+    typedef ci0::Function<int(), SboSize, Align> IntFn;
+    AlignedDerived<ObjAlign> obj(2);
+    IntFn fn1 = [obj]() { return IsAligned(&obj, ObjAlign) ? obj.foo : -1; };
+    IntFn fn2 = fn1;
+    IntFn fn3 = std::move(fn2);
+    bool aligned = (fn1() == 2) && (fn3() == 2);
+    printf("Function<int(), %2u, %2u> holding align=%2u lambda: aligned=%d\n",
+        unsigned(SboSize), unsigned(Align), unsigned(ObjAlign), aligned);
+    assert(aligned);
+}
+
+void TestAlignment()
+{
+    // {object alignment} x {SboSize} x {SBO alignment}; includes objects more aligned than the SBO
+    TestClonePtrAlignment<AlignedDerived<8>, 8, alignof(std::max_align_t)>();
+    TestClonePtrAlignment<AlignedDerived<8>, 64, 8>();
+    TestClonePtrAlignment<AlignedDerived<16>, 64, 8>();
+    TestClonePtrAlignment<AlignedDerived<16>, 64, 16>();
+    TestClonePtrAlignment<AlignedDerived<32>, 64, 16>();
+    TestClonePtrAlignment<AlignedDerived<32>, 64, 32>();
+    TestClonePtrAlignment<AlignedDerived<64>, 128, 32>();
+
+    TestFunctionAlignment<8, 32, 8>();
+    TestFunctionAlignment<16, 32, 8>();
+    TestFunctionAlignment<16, 32, 16>();
+    TestFunctionAlignment<32, 64, 16>();
+    TestFunctionAlignment<32, 64, 32>();
+}
+
+struct MoveOnlyDerived : EarlierBase, Base
+{
+    ci0::UniquePtr<int> pBar;
+
+    MoveOnlyDerived(int foo_, int bar_) : pBar(new int(bar_)) { foo = foo_; }
+    MoveOnlyDerived(MoveOnlyDerived&& rhs) CI0_NOEXCEPT(true) : pBar(std::move(rhs.pBar)) { foo = rhs.foo; }
+};
+struct BigMoveOnlyDerived : MoveOnlyDerived
+{
+    char padding[64] = {};
+
+    BigMoveOnlyDerived(int foo_, int bar_) : MoveOnlyDerived(foo_, bar_) {}
+};
+
+void TestInplacePtr()
+{
+    {
+        ci0::InplacePtr<Base, 16> pBase1(MoveOnlyDerived(3, 4));
+        ci0::InplacePtr<Base, 16> pBase2 = std::move(pBase1);
+        if (!pBase1)
+        {
+            printf("pBase1 cleared\n");
+        }
+        UseBase(pBase2);
+        printf("MoveOnlyDerived.bar=%d\n", *((MoveOnlyDerived*)pBase2)->pBar);
+
+        ci0::InplacePtr<Base, 16> pBase3(BigMoveOnlyDerived(5, 6));   // heap fallback
+        pBase2.swap(pBase3);
+        UseBase(pBase2);
+        UseBase(pBase3);
+        ci0::InplacePtr<Base, 0> pBase4 = std::move(pBase3);
+        pBase4.assign(MoveOnlyDerived(7, 8));
+        pBase2 = std::move(pBase4);
+        UseBase(pBase2);
+
+        ci0::InplacePtr<Base, 16> pBase5 = pBase2.move_as<Base, 16>();
+        pBase5.attach(new MoveOnlyDerived(9, 10));
+        UseBase(pBase5);
+
+#if ENABLE_MISUSE
+        ci0::InplacePtr<Base, 16> pBase6 = pBase5;    // misuse causes compile error: InplacePtr is move-only
+        MoveOnlyDerived der(1, 2);
+        pBase5.assign(der);                           // misuse causes compile error: lvalues would require a copy
+        delete pBase5;
+#endif
+
+        bool testComparisons = false;
+        testComparisons = (pBase2 == pBase5);
+        testComparisons = (pBase2 != pBase5);
+        testComparisons = (pBase2 == (Base*)pBase5); // implicit cast handled this
+        testComparisons = (pBase2 == nullptr);
+        testComparisons = (nullptr != pBase2);
+    }
+}
+
 
 struct RcBase
 {
@@ -300,8 +716,27 @@ void UseStdFunction(const char* pName, const std::function<int(int, int)>& func)
     printf("%d = %s(%d, %d)\n", func(1, 2), pName, 1, 2);
 }
 
+// FuncRef is two trivially copyable words, so it is passed in registers; with optimizations this compiles
+// to a tail call through m_wrapperFn, with no stack traffic.
+__declspec(noinline)
+int CallFuncRefByValue(ci0::FuncRef<int(int, int)> func)
+{
+    return func(1, 2);
+}
+
 void TestFuncRef(int argc)
 {
+    static_assert(sizeof(ci0::FuncRef<int(int, int)>) == 2 * sizeof(void*), "");
+    static_assert(std::is_trivially_copyable<ci0::FuncRef<int(int, int)>>::value, "");
+    {
+        auto multiply = [](int x, int y) { return x * y; };
+        ci0::FuncRef<int(int, int)> fnRef = multiply;
+        ci0::FuncRef<int(int, int)> fnRef2 = fnRef;
+        ci0::FuncRef<int(int, int)> fnRef3 = std::move(fnRef2);
+        const ci0::FuncRef<int(int, int)> fnRef4 = fnRef3;
+        fnRef2 = fnRef4;
+        assert(CallFuncRefByValue(fnRef) == 2 && CallFuncRefByValue(fnRef2) == 2 && CallFuncRefByValue(multiply) == 2);
+    }
     {
         typedef ci0::FuncRef<int(int, int)> CombineFnRef;
 
@@ -438,12 +873,869 @@ void TestFunction(int argc)
 }
 
 
+// neither movable nor default-constructible; can only be constructed in its final location
+struct PinnedDerived : Base
+{
+    PinnedDerived(int foo_, int bar_) { foo = foo_ + bar_; }
+    PinnedDerived(const PinnedDerived& rhs) { foo = rhs.foo; }
+    PinnedDerived(PinnedDerived&& rhs) = delete;
+};
+
+void TestEmplace()
+{
+    typedef ci0::ClonePtr<Base, 16> BasePtr16;
+    {
+        int copyCount = CountedDerived::s_copyCount;
+        BasePtr16 pCounted = ci0::MakeClone<Base, CountedDerived, 16>(5);
+        pCounted.emplace<BigCountedDerived>(6);
+        printf("emplace: copies=%d foo=%d\n", CountedDerived::s_copyCount - copyCount, pCounted->foo);
+        assert(CountedDerived::s_copyCount == copyCount && pCounted->foo == 6);
+
+        BasePtr16 pPinned;
+        pPinned.emplace<PinnedDerived>(1, 2);
+        BasePtr16 pPinned2 = pPinned;
+        ci0::ClonePtr<Base> pPinned3 = ci0::MakeClone<Base, PinnedDerived>(3, 4);
+        UseBase(pPinned2);
+        UseBase(pPinned3);
+    }
+    {
+        struct Accumulate
+        {
+            int base;
+            Accumulate(int base_) : base(base_) {}
+            int operator()(int x, int y) const { return base + x + y; }
+        };
+        ci0::Function<int(int, int)> combineFn;
+        combineFn.emplace<Accumulate>(100);
+        UseFunction("combineFn.emplace<Accumulate>", combineFn);
+        ci0::Function<int(int, int), 0> combineFn0;
+        combineFn0.emplace<Accumulate>(200);
+        UseFunction("combineFn0.emplace<Accumulate>", combineFn0);
+    }
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+void TestExactTypeCast()
+{
+    {
+        ci0::ClonePtr<Base> pBase(Derived(1, 2));
+        ci0::ClonePtr<Base, 16> pSbo(RelocatableDerived(3));
+        ci0::ClonePtr<Base, 0> pHeap(Derived(4, 5));
+        assert(pBase.is<Derived>() && !pBase.is<RelocatableDerived>());
+        assert(pBase.as<Derived>() == dynamic_cast<Derived*>(pBase.get()) && pBase.as<Derived>()->bar == 2);
+        assert(pBase.as<RelocatableDerived>() == nullptr);
+        assert(pSbo.as<RelocatableDerived>() == pSbo.get() && pSbo.as<RelocatableDerived>()->foo == 3);
+        assert(pHeap.as<Derived>() == dynamic_cast<Derived*>(pHeap.get()) && pHeap.as<Derived>()->bar == 5);
+        pBase = nullptr;
+        assert(!pBase.is<Derived>() && pBase.as<Derived>() == nullptr);
+
+        ci0::CowPtr<Base> pCow(Derived(6, 7));
+        assert(pCow.is<Derived>() && pCow.as<Derived>()->bar == 7 && !pCow.as<RelocatableDerived>());
+    }
+    {
+        struct Offset
+        {
+            int offset;
+            int operator()(int x, int y) const { return x + y + offset; }
+        };
+        struct Other
+        {
+            int operator()(int x, int y) const { return x * y; }
+        };
+        ci0::Function<int(int, int)> fn = Offset{ 10 };
+        ci0::Function<int(int, int), 0> fn0 = Offset{ 20 };
+        assert(fn.target<Offset>() && fn.target<Offset>()->offset == 10 && !fn.target<Other>());
+        assert(fn0.target<Offset>() && fn0.target<Offset>()->offset == 20 && !fn0.target<Other>());
+        fn.target<Offset>()->offset = 30;
+        printf("%d = fn.target<Offset>() modified(1, 2)\n", fn(1, 2));
+        assert(fn(1, 2) == 33);
+    }
+}
+
+struct ArgCounter
+{
+    static int s_copyCount;
+    static int s_moveCount;
+    int value;
+
+    ArgCounter(int value_) : value(value_) {}
+    ArgCounter(const ArgCounter& rhs) : value(rhs.value) { ++s_copyCount; }
+    ArgCounter(ArgCounter&& rhs) : value(rhs.value) { ++s_moveCount; }
+};
+int ArgCounter::s_copyCount;
+int ArgCounter::s_moveCount;
+
+int SumArgCounter(ArgCounter arg, const ArgCounter& ref)
+{
+    return arg.value + ref.value;
+}
+
+void TestFunctionForwarding()
+{
+    ArgCounter arg(1);
+    ci0::Function<int(ArgCounter, const ArgCounter&)> fn = [](ArgCounter arg, const ArgCounter& ref) { return arg.value + ref.value; };
+    ci0::Function<int(ArgCounter, const ArgCounter&)> rawFn = &SumArgCounter;
+    ci0::FuncRef<int(ArgCounter, const ArgCounter&)> fnRef = fn;
+
+    // one copy into operator(), then one move into the target's by-value parameter
+    ArgCounter::s_copyCount = ArgCounter::s_moveCount = 0;
+    assert(fn(arg, arg) == 2 && rawFn(arg, arg) == 2 && fnRef(arg, arg) == 2);
+    printf("Function(ArgCounter lvalue): copies=%d moves=%d\n", ArgCounter::s_copyCount, ArgCounter::s_moveCount);
+    assert(ArgCounter::s_copyCount == 3 && ArgCounter::s_moveCount == 3);
+
+    ArgCounter::s_copyCount = ArgCounter::s_moveCount = 0;
+    assert(fn(ArgCounter(2), arg) == 3);
+    printf("Function(ArgCounter rvalue): copies=%d moves=%d\n", ArgCounter::s_copyCount, ArgCounter::s_moveCount);
+    assert(ArgCounter::s_copyCount == 0 && ArgCounter::s_moveCount == 1);
+
+    // move-only arguments
+    ci0::Function<int(ci0::UniquePtr<int>)> consume = [](ci0::UniquePtr<int> pInt) { return *pInt; };
+    assert(consume(ci0::UniquePtr<int>(new int(7))) == 7);
+}
+
+struct UniqueAdder
+{
+    static int s_liveCount;
+    ci0::UniquePtr<int> pBase;
+
+    UniqueAdder(int base) : pBase(new int(base)) { ++s_liveCount; }
+    UniqueAdder(UniqueAdder&& rhs) CI0_NOEXCEPT(true) : pBase(std::move(rhs.pBase)) { ++s_liveCount; }
+    ~UniqueAdder() { --s_liveCount; }
+    int operator()(int x) const { return *pBase + x; }
+};
+int UniqueAdder::s_liveCount;
+
+struct PinnedAdder
+{
+    int base;
+    PinnedAdder(int base_) : base(base_) {}
+    PinnedAdder(PinnedAdder&&) = delete;
+    int operator()(int x) const { return base + x; }
+};
+
+void TestUniqueFunction()
+{
+    {
+        typedef ci0::UniqueFunction<int(int), 16> AddFn;
+        ci0::UniquePtr<int> pTen(new int(10));
+        AddFn addTen = [pTen = std::move(pTen)](int x) { return *pTen + x; };
+        printf("%d = addTen(1)\n", addTen(1));
+        assert(addTen(1) == 11);
+
+        AddFn addA = UniqueAdder(1);
+        assert(addA(1) == 2 && addA.target<UniqueAdder>() && UniqueAdder::s_liveCount == 1);
+        // SBO -> heap
+        ci0::UniqueFunction<int(int), 0> addB = std::move(addA);
+        assert(!addA && addB(1) == 2 && UniqueAdder::s_liveCount == 1);
+        // heap -> SBO holder; the heap object is stolen
+        int* pBase = addB.target<UniqueAdder>()->pBase.get();
+        addA = std::move(addB);
+        assert(!addB && addA.target<UniqueAdder>()->pBase.get() == pBase && UniqueAdder::s_liveCount == 1);
+
+        ci0::FuncRef<int(int)> addRef = addA;
+        assert(addRef(2) == 3);
+
+        addA.emplace<PinnedAdder>(5);
+        assert(addA(1) == 6 && UniqueAdder::s_liveCount == 0);
+        addB = std::move(addA);
+        assert(addB(1) == 6);
+
+        addB = &Negate;
+        assert(addB(1) == -1 && !addB.target<PinnedAdder>());
+        addA = std::move(addB);
+        assert(addA(2) == -2);
+        addA = nullptr;
+        assert(!addA);
+    }
+    assert(UniqueAdder::s_liveCount == 0);
+}
+
+// trivially copyable, and bigger than a pointer
+struct Point3
+{
+    int x, y, z;
+    int operator()(int i) const { return x + y * i + z * i * i; }
+};
+
+void TestTrivialFunction()
+{
+    static_assert(std::is_trivially_copyable<Point3>::value, "");
+    typedef ci0::Function<int(int), 16, 8> PointFn;
+    typedef ci0::Function<int(int), 8, 8> SmallFn;
+
+    PointFn fnA = Point3{ 1, 2, 3 };
+    PointFn fnB = fnA;
+    PointFn fnC = std::move(fnB);
+    assert(!fnB && fnA(1) == 6 && fnC(2) == 17);
+    assert(fnC.target<Point3>() && fnC.target<Point3>()->z == 3);
+    fnC.target<Point3>()->z = 0;
+    fnA = fnC;
+    assert(fnA(2) == 5);
+
+    // the object no longer fits the SBO of a smaller Function, so it moves to the heap, and back
+    SmallFn fnSmall = fnA;
+    ci0::Function<int(int), 0> fnHeap = fnA;
+    assert(fnSmall(2) == 5 && fnHeap(2) == 5 && fnSmall.target<Point3>());
+    PointFn fnD = std::move(fnSmall);
+    fnB = fnHeap;
+    assert(!fnSmall && fnD(2) == 5 && fnB(2) == 5 && fnD.target<Point3>() && fnB.target<Point3>());
+    fnB = std::move(fnD);
+    fnB = nullptr;
+    assert(!fnB);
+}
+
+void TestFixedFunction()
+{
+    int offset = 5;
+    auto addOffset = [&offset](int i) { return i + offset; };
+
+    typedef ci0::FixedFunctionFor<int(int), Point3, decltype(addOffset)> AnyFn;
+    static_assert(ci0::FixedFunctionCapacity<Point3, decltype(addOffset)>::size == (sizeof(Point3) > sizeof(void*) ? sizeof(Point3) : sizeof(void*)), "");
+    AnyFn fnA = Point3{ 1, 2, 3 };
+    AnyFn fnB = addOffset;
+    assert(fnA(1) == 6 && fnB(1) == 6 && fnA.target<Point3>() && !fnB.target<Point3>());
+    fnA = fnB;
+    fnB = &Negate;
+    assert(fnA(2) == 7 && fnB(2) == -2);
+
+    // a smaller FixedFunction converts to a bigger one
+    auto fnExact = ci0::MakeFixedFunction<int(int)>(addOffset);
+    static_assert(sizeof(fnExact) == 4 * sizeof(void*), "no buffer space beyond the lambda");
+    ci0::FixedFunction<int(int), 64> fnBig = fnExact;
+    fnBig = std::move(fnA);
+    assert(!fnA && fnBig(3) == 8 && fnExact(3) == 8);
+
+    // non-trivial function objects are copied, moved and destroyed in place
+    {
+        struct SharedAdder
+        {
+            std::shared_ptr<int> pBase;
+            int operator()(int i) const { return *pBase + i; }
+        };
+        ci0::FixedFunctionFor<int(int), SharedAdder> fnShared = SharedAdder{ std::make_shared<int>(10) };
+        auto fnShared2 = fnShared;
+        ci0::FixedFunction<int(int), 32> fnShared3 = std::move(fnShared);
+        ci0::FuncRef<int(int)> fnRef = fnShared3;
+        assert(!fnShared && fnShared2(1) == 11 && fnRef(2) == 12);
+        assert(fnShared2.target<SharedAdder>()->pBase.use_count() == 2);
+    }
+
+#if ENABLE_MISUSE
+    int values[16] = {};
+    ci0::FixedFunction<int(int)> tooBig = [values](int i) { return values[i]; };    // misuse causes compile error: FixedFunction: the function object does not fit in Capacity
+    ci0::FixedFunction<int(int), 8> fromBigger = fnBig;    // misuse causes compile error: FixedFunction: rhs's Capacity exceeds this Capacity
+#endif
+}
+
+struct Counter
+{
+    int count;
+    int Add(int x) { return count += x; }
+    int Get() const { return count; }
+};
+struct RcCounter : RcBase
+{
+    RcCounter() : RcBase(0) {}
+    int Add(int x) { return foo += x; }
+};
+
+void TestBindMember()
+{
+    Counter counter = { 0 };
+    ci0::Function<int(int)> addFn = ci0::BindMember<CI0_MEMBER(&Counter::Add)>(&counter);
+    ci0::Function<int()> getFn = ci0::BindMember<CI0_MEMBER(&Counter::Get)>((const Counter*)&counter);
+    ci0::FixedFunction<int(int)> addFixed = ci0::BindMember<CI0_MEMBER(&Counter::Add)>(&counter);
+    // a FuncRef binds the receiver itself, so binding the temporary delegate is safe
+    ci0::FuncRef<int(int)> addRef = ci0::BindMember<CI0_MEMBER(&Counter::Add)>(&counter);
+    auto addRef2 = ci0::FuncRef<int(int)>::bind<CI0_MEMBER(&Counter::Add)>(&counter);
+    assert(addFn(1) == 1 && addFixed(2) == 3 && addRef(3) == 6 && addRef2(4) == 10 && getFn() == 10);
+#if defined(__cpp_nontype_template_parameter_auto)
+    ci0::Function<int(int)> addFn17 = ci0::BindMember<&Counter::Add>(&counter);
+    auto addRef17 = ci0::FuncRef<int(int)>::bind<&Counter::Add>(&counter);
+    assert(addFn17(1) == 11 && addRef17(1) == 12);
+#endif
+
+    // an IntrusivePtr receiver is kept alive by the Function
+    ci0::Function<int(int)> rcAddFn;
+    {
+        ci0::IntrusivePtr<RcCounter> pCounter(new RcCounter(), false);
+        typedef ci0::MemberDelegate<CI0_MEMBER(&RcCounter::Add), ci0::IntrusivePtr<RcCounter>> RcAddDelegate;
+        static_assert(sizeof(RcAddDelegate) == sizeof(void*), "fits in the default SBO");
+        rcAddFn = ci0::BindMember<CI0_MEMBER(&RcCounter::Add)>(pCounter);
+        assert(pCounter->refcount == 2 && rcAddFn.target<RcAddDelegate>());
+    }
+    assert(rcAddFn(5) == 5 && rcAddFn(5) == 10);
+    rcAddFn = nullptr;
+}
+
+struct ConstCallCounter
+{
+    int* pCount;
+    int operator()(int x) const { return *pCount += x; }
+    int operator()(int x) { return *pCount -= x; }
+};
+
+void TestQualifiedSignature()
+{
+    // a const signature calls the target's const operator()
+    int count = 0;
+    ci0::Function<int(int) const> constFn = ConstCallCounter{ &count };
+    ci0::Function<int(int)> plainFn = ConstCallCounter{ &count };
+    ci0::FuncRef<int(int) const> constRef = constFn;
+    assert(constFn(2) == 2 && constRef(3) == 5 && plainFn(1) == 4);
+    ci0::UniqueFunction<int(int) const> uniqueConstFn = std::move(constFn);
+    ci0::FixedFunction<int(int) const> fixedConstFn = &Negate;
+    assert(uniqueConstFn(1) == 5 && fixedConstFn(1) == -1);
+#if ENABLE_MISUSE
+    constFn = [count](int x) mutable { return count += x; };    // misuse causes compile error: no match for call to (const lambda)
+#endif
+
+#if defined(__cpp_noexcept_function_type)
+    {
+        ci0::Function<int(int) noexcept> nothrowFn = [](int x) noexcept { return x * 2; };
+        ci0::FuncRef<int(int) const noexcept> nothrowRef = [](int x) noexcept { return x * 3; };
+        static_assert(noexcept(nothrowFn(1)) && noexcept(nothrowRef(1)), "");
+        static_assert(!noexcept(plainFn(1)), "");
+        static_assert(std::is_nothrow_move_constructible<ci0::Function<int(int) noexcept>>::value, "");
+        assert(nothrowFn(2) == 4 && nothrowRef(2) == 6);
+        struct Doubler
+        {
+            int Double(int x) noexcept { return x * 2; }
+        } doubler;
+        nothrowFn = ci0::BindMember<&Doubler::Double>(&doubler);
+        assert(nothrowFn(4) == 8);
+#if ENABLE_MISUSE
+        nothrowFn = [](int x) { return x; };    // misuse causes compile error: a Function with a noexcept signature requires a noexcept function object
+        nothrowFn = &Negate;                    // misuse causes compile error: Negate is not noexcept
+#endif
+    }
+#endif
+}
+
+void TestFunctionConversion()
+{
+    struct AddOffset
+    {
+        int offset;
+        int operator()(int i) const { return i + offset; }
+    };
+
+    // a Function with a compatible signature takes the target itself, rather than wrapping the other Function
+    ci0::Function<int(int) const> constFn = AddOffset{ 1 };
+    ci0::Function<int(int)> plainFn = constFn;
+    ci0::Function<int(int), 32> bigFn = std::move(constFn);
+    assert(!constFn && plainFn.target<AddOffset>() && bigFn.target<AddOffset>() && plainFn(1) == 2);
+    ci0::FixedFunction<int(int) const> fixedConstFn = AddOffset{ 2 };
+    ci0::FixedFunction<int(int)> fixedFn = fixedConstFn;
+    assert(fixedFn.target<AddOffset>() && fixedFn(1) == 3);
+    ci0::FuncRef<int(int)> fnRef = fixedConstFn;
+    assert(fnRef(2) == 4);
+
+    // a UniqueFunction takes the target of a Function; a heap-allocated target is stolen
+    ci0::UniqueFunction<int(int)> uniqueFn = plainFn;
+    assert(plainFn && uniqueFn.target<AddOffset>() && uniqueFn(2) == 3);
+    int values[8] = { 0, 10, 20 };
+    auto lookup = [values](int i) { return values[i]; };
+    ci0::Function<int(int) const> heapFn = lookup;
+    const void* pLookup = heapFn.target<decltype(lookup)>();
+    uniqueFn = std::move(heapFn);
+    assert(!heapFn && uniqueFn.target<decltype(lookup)>() == pLookup && uniqueFn(2) == 20);
+    ci0::UniqueFunction<int(int), 0> uniqueHeapFn = std::move(uniqueFn);
+    assert(!uniqueFn && uniqueHeapFn.target<decltype(lookup)>() == pLookup);
+
+    // std::function
+    std::function<int(int)> stdFnRef = ci0::StdFunctionRef<int(int)>(fixedConstFn);
+    assert(stdFnRef(3) == 5 && stdFnRef.target<ci0::FuncRef<int(int)>>());
+    std::function<int(int)> stdFn = plainFn;
+    ci0::Function<int(int)> fromStdFn = ci0::FromStdFunction<ci0::Function<int(int)>>(std::move(stdFn));
+    assert(fromStdFn.target<AddOffset>() && fromStdFn(3) == 4);
+    ci0::StdFunctionHolder<int(int)> stdFnHolder = std::function<int(int)>(lookup);
+    assert(stdFnHolder(1) == 10);
+#if defined(__cpp_lib_move_only_function)
+    std::move_only_function<int(int) const> moveOnlyFnRef = ci0::StdMoveOnlyFunctionRef<int(int) const>(fixedConstFn);
+    ci0::StdMoveOnlyFunctionHolder<int(int) const> moveOnlyFnHolder = std::move_only_function<int(int) const>(lookup);
+    assert(moveOnlyFnRef(1) == 3 && moveOnlyFnHolder(2) == 20);
+#endif
+
+#if defined(__cpp_noexcept_function_type)
+    auto negate = [](int i) noexcept { return -i; };
+    ci0::Function<int(int) noexcept> nothrowFn = negate;
+    ci0::Function<int(int)> fromNothrowFn = nothrowFn;
+    assert(fromNothrowFn(1) == -1 && fromNothrowFn.target<decltype(negate)>());
+#endif
+#if ENABLE_MISUSE
+    ci0::UniqueFunction<int(int)> fromLvalue = uniqueHeapFn;    // misuse causes compile error: no matching function (a UniqueFunction cannot be copied)
+#endif
+}
+
+void TestCompactFunction()
+{
+    // a descriptor pointer plus a one-pointer SBO, which holds a lambda capturing a single pointer
+    typedef ci0::CompactFunction<int(int)> CompactFn;
+    static_assert(sizeof(CompactFn) == 2 * sizeof(void*), "");
+    static_assert(sizeof(ci0::Function<int(int)>) == 2 * sizeof(CompactFn), "");
+    int offset = 5;
+    auto addOffset = [&offset](int i) { return i + offset; };
+    CompactFn fnA = addOffset;
+    CompactFn fnB = &Negate;
+    CompactFn fnEmpty;
+    assert(fnA(1) == 6 && fnB(1) == -1 && !fnEmpty && (const char*)fnA.target<decltype(addOffset)>() == (const char*)&fnA + sizeof(void*));
+    fnEmpty = fnA;
+    fnA = std::move(fnB);
+    assert(fnEmpty(2) == 7 && fnA(2) == -2 && !fnB);
+
+    // bigger function objects are allocated, and the SBO holds the pointer; moves steal it
+    int values[8] = { 0, 10, 20 };
+    auto lookup = [values](int i) { return values[i]; };
+    CompactFn fnHeap = lookup;
+    const void* pLookup = fnHeap.target<decltype(lookup)>();
+    CompactFn fnHeap2 = fnHeap;
+    CompactFn fnHeap3 = std::move(fnHeap);
+    assert(!fnHeap && fnHeap3.target<decltype(lookup)>() == pLookup && fnHeap2.target<decltype(lookup)>() != pLookup);
+    assert(fnHeap2(1) == 10 && fnHeap3(2) == 20);
+    fnHeap2 = *fnHeap2.target<decltype(lookup)>();   // assigning from the current target copies it before releasing it
+    assert(fnHeap2(2) == 20);
+
+    // non-trivial function objects in the SBO are copied, moved and destroyed in place
+    {
+        auto pBase = std::make_shared<int>(10);
+        ci0::CompactFunction<int(int) const, 2 * sizeof(void*)> fnShared = [pBase](int i) { return *pBase + i; };
+        auto fnShared2 = fnShared;
+        auto fnShared3 = std::move(fnShared);
+        assert(!fnShared && fnShared2(1) == 11 && fnShared3(2) == 12 && pBase.use_count() == 3);
+        fnShared2 = nullptr;
+        assert(pBase.use_count() == 2);
+    }
+
+    struct Scale
+    {
+        int factor;
+        int operator()(int i) const { return i * factor; }
+    };
+    Counter counter = { 0 };
+    CompactFn fnMember = ci0::BindMember<CI0_MEMBER(&Counter::Add)>(&counter);
+    assert(fnMember(3) == 3 && counter.count == 3);
+    fnMember.emplace<Scale>(Scale{ 3 });
+    assert(fnMember(2) == 6 && fnMember.target<Scale>() && !fnMember.target<decltype(lookup)>());
+}
+
+void TestFunctionDebug()
+{
+    // debug info lives in a side table, so it never changes object layout
+    static_assert(sizeof(ci0::Function<int(int, int)>) == 4 * sizeof(void*), "");
+    static_assert(sizeof(ci0::Function<int(int, int), sizeof(void*), alignof(void*)>) == 4 * sizeof(void*), "");
+    static_assert(sizeof(ci0::UniqueFunction<int(int)>) == 4 * sizeof(void*), "");
+    static_assert(sizeof(ci0::Function<int(int, int), 0>) == 3 * sizeof(void*), "");
+    static_assert(sizeof(ci0::FuncRef<int(int, int)>) == 2 * sizeof(void*), "");
+#if FUNCTION_ENABLE_DEBUG
+    struct DebugTarget
+    {
+        int operator()(int x, int y) const { return x - y; }
+    };
+    ci0::Function<int(int, int)> fn = DebugTarget();
+    assert(fn(3, 1) == 2);
+    const ci0::FunctionDebugEntry* pFound = nullptr;
+    for (const ci0::FunctionDebugEntry* pEntry = ci0::FunctionDebugRegistry::First(); pEntry; pEntry = pEntry->pNext)
+    {
+        if (strstr(pEntry->typeName, "DebugTarget"))
+        {
+            pFound = pEntry;
+        }
+    }
+    assert(pFound && ci0::FunctionDebugRegistry::Find(pFound->wrapperFn) == pFound);
+    printf("FunctionDebugEntry: %s\n", pFound->typeName);
+#endif
+}
+
+struct NamedDerived : Base
+{
+    std::string name;
+
+    NamedDerived(const char* pName) : name(pName) { foo = (int)name.size(); }
+};
+
+void TestPolyVector()
+{
+    {
+        ci0::PolyVector<Base> objects;
+        for (int i = 0; i < 30; ++i)
+        {
+            switch (i % 3)
+            {
+            case 0: objects.push_back(RelocatableDerived(i)); break;
+            case 1: objects.emplace_back<CountedDerived>(i); break;
+            case 2: objects.emplace_back<Derived>(i, -i); break;
+            }
+        }
+        assert(objects.size() == 30 && CountedDerived::s_liveCount == 10);
+        int index = 0;
+        for (Base& obj : objects)
+        {
+            assert(obj.foo == index++);
+        }
+        assert(objects.as<Derived>(2)->bar == -2 && !objects.as<Derived>(3));
+
+        ci0::PolyVector<Base> copy = objects;
+        assert(CountedDerived::s_liveCount == 20);
+        copy[0].foo = 100;
+        assert(objects[0].foo == 0);
+
+        // grouped visitation: each type's objects are consecutive, in insertion order
+        std::vector<int> visited;
+        objects.for_each_grouped([&](Base& obj) { visited.push_back(obj.foo); });
+        assert(visited.size() == 30);
+        int groupStarts = 0;
+        for (size_t i = 0; i < visited.size(); ++i)
+        {
+            if (i == 0 || visited[i] % 3 != visited[i - 1] % 3)
+            {
+                ++groupStarts;
+            }
+            else
+            {
+                assert(visited[i] == visited[i - 1] + 3);
+            }
+        }
+        printf("PolyVector: size=%d bytes=%d groups=%d\n", (int)objects.size(), (int)objects.size_bytes(), groupStarts);
+        assert(groupStarts == 3);
+
+        objects.pop_back();
+        objects.pop_back();
+        assert(objects.size() == 28 && CountedDerived::s_liveCount == 19);
+        ci0::PolyVector<Base> moved = std::move(objects);
+        assert(objects.empty() && moved.size() == 28);
+        copy.clear();
+        assert(CountedDerived::s_liveCount == 9);
+
+        const ci0::PolyVector<Base>& constMoved = moved;
+        int constVisits = 0;
+        constMoved.for_each_grouped([&](const Base&) { ++constVisits; });
+        assert(constVisits == 28);
+        static_assert(std::is_same<decltype(constMoved.as<CountedDerived>(0)), const CountedDerived*>::value, "");
+    }
+    assert(CountedDerived::s_liveCount == 0);
+
+    {
+        // the argument may be an element, even when the buffer grows (so the element is relocated)
+        ci0::PolyVector<Base> named;
+        named.emplace_back<NamedDerived>("a name that is too long for the small string buffer");
+        while (named.size_bytes() + sizeof(NamedDerived) <= 64)
+        {
+            named.push_back(*named.as<NamedDerived>(0));
+        }
+        named.push_back(*named.as<NamedDerived>(0));
+        for (size_t i = 0; i < named.size(); ++i)
+        {
+            assert(named.as<NamedDerived>(i)->name == named.as<NamedDerived>(0)->name && named[i].foo == named[0].foo);
+        }
+    }
+}
+
+void TestClosedPolyPtr()
+{
+    typedef ci0::ClosedPolyPtr<Base, 16, RelocatableDerived, CountedDerived, Derived> BaseClosedPtr;
+    {
+        BaseClosedPtr pA(RelocatableDerived(1));
+        BaseClosedPtr pB(CountedDerived(2));
+        BaseClosedPtr pC;
+        pC.emplace<Derived>(3, 4); // 24+ bytes; on the heap
+        assert(pA.is<RelocatableDerived>() && pB.is<CountedDerived>() && pC.is<Derived>() && !pC.is<CountedDerived>());
+        assert(pC.as<Derived>()->bar == 4 && pC.as<Derived>() == dynamic_cast<Derived*>(pC.get()));
+
+        struct Describe
+        {
+            int operator()(RelocatableDerived& obj) const { return 100 + obj.foo; }
+            int operator()(CountedDerived& obj) const { return 200 + obj.foo; }
+            int operator()(Derived& obj) const { return 300 + obj.foo * 10 + obj.bar; }
+        };
+        printf("ClosedPolyPtr visit: %d %d %d\n", pA.visit(Describe()), pB.visit(Describe()), pC.visit(Describe()));
+        assert(pA.visit(Describe()) == 101 && pB.visit(Describe()) == 202 && pC.visit(Describe()) == 334);
+
+        const BaseClosedPtr& pConstB = pB;
+        int foo = pConstB.visit([](const Base& obj) { return obj.foo; });
+        assert(foo == 2);
+
+        BaseClosedPtr pD = pB;
+        BaseClosedPtr pE = pC;
+        assert(CountedDerived::s_liveCount == 2 && pE.get() != pC.get() && pE.as<Derived>()->bar == 4);
+        BaseClosedPtr pF = std::move(pE);
+        assert(!pE && pF->foo == 3);
+        pF.swap(pD);
+        assert(pF.is<CountedDerived>() && pD.is<Derived>() && pD->foo == 3);
+        pF = pA;
+        assert(CountedDerived::s_liveCount == 1 && pF.is<RelocatableDerived>());
+        pB = nullptr;
+        assert(CountedDerived::s_liveCount == 0);
+        UseBase(pD);
+
+        // the source may be the current object
+        pD.assign(*pD.as<Derived>());
+        assert(pD.is<Derived>() && pD->foo == 3 && pD.as<Derived>()->bar == 4);
+        pF.emplace<RelocatableDerived>(*pF.as<RelocatableDerived>());
+        assert(pF.is<RelocatableDerived>() && pF->foo == 1);
+    }
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+void TestCowPtr()
+{
+    typedef ci0::CowPtr<Base> BaseCowPtr;
+    {
+        int copyCount = CountedDerived::s_copyCount;
+        BaseCowPtr pA(CountedDerived(1));
+        BaseCowPtr pB = pA;
+        BaseCowPtr pC = pB;
+        std::vector<BaseCowPtr> snapshots(10, pA);
+        printf("CowPtr: copies=%d use_count=%d\n", CountedDerived::s_copyCount - copyCount, (int)pA.use_count());
+        assert(pA.get() == pC.get() && pA.use_count() == 13);
+        UseBase((Base*)pB.get());
+
+        // mutating a shared object clones it; others keep the old value
+        int copyCountBefore = CountedDerived::s_copyCount;
+        pB.mutate()->foo = 2;
+        assert(CountedDerived::s_copyCount == copyCountBefore + 1);
+        assert(pA->foo == 1 && pB->foo == 2 && pC->foo == 1);
+        assert(pB.unique() && pA.use_count() == 12);
+
+        // mutating a unique object does not clone
+        pB.mutate()->foo = 3;
+        assert(CountedDerived::s_copyCount == copyCountBefore + 1 && pB->foo == 3);
+
+        ci0::ClonePtr<Base> pClone = pC.clone();
+        pClone->foo = 4;
+        assert(pC->foo == 1);
+        BaseCowPtr pD(std::move(pClone));
+        assert(pD->foo == 4 && !pClone);
+        ci0::ClonePtr<Base> pLvalue(CountedDerived(7));
+        BaseCowPtr pE(pLvalue);
+        assert(pE->foo == 7 && pLvalue->foo == 7 && pE.get() != pLvalue.get());
+
+        pD.emplace<Derived>(5, 6);
+        assert(((const Derived*)pD)->bar == 6);
+        pD.swap(pA);
+        assert(pA->foo == 5 && pD->foo == 1);
+        pA = nullptr;
+        assert(!pA && pA.mutate() == nullptr && pA.use_count() == 0);
+    }
+    assert(CountedDerived::s_liveCount == 0);
+}
+
+#if ENABLE_BENCHMARKS
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_RDTSC 1
+#else
+#define HAS_RDTSC 0
+#endif
+
+// Reads the time-stamp counter.  On current x86 CPUs it ticks at a constant (nominal) rate, so it counts reference
+// cycles, not core cycles, and is not serializing; over the thousands of operations averaged below neither matters much.
+inline uint64_t ReadCycleCounter()
+{
+#if HAS_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct PodPoint
+{
+    int x, y;
+};
+
+// Reports the average time (and, on x86, reference cycles) to copy-construct and destroy one Holder.
+template <class Holder>
+void BenchmarkCopyDestroy(const char* pName, const Holder& proto)
+{
+    const int count = 1000;
+    const int iterations = 2000;
+    std::vector<Holder> src(count, proto);
+    std::vector<char> dstMem(count * sizeof(Holder) + alignof(Holder));
+    Holder* pDst = (Holder*)(((uintptr_t)dstMem.data() + alignof(Holder) - 1) & ~(uintptr_t)(alignof(Holder) - 1));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t startCycles = ReadCycleCounter();
+    for (int iter = 0; iter < iterations; ++iter)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            new (&pDst[i]) Holder(src[i]);
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            pDst[i].~Holder();
+        }
+    }
+    uint64_t endCycles = ReadCycleCounter();
+    auto end = std::chrono::high_resolution_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    double ops = double(count) * iterations;
+#if HAS_RDTSC
+    printf("%-40s %6.2f ns/op %7.1f cycles/op\n", pName, ns / ops, double(endCycles - startCycles) / ops);
+#else
+    printf("%-40s %6.2f ns/op\n", pName, ns / ops);
+#endif
+}
+
+struct Shape
+{
+    virtual ~Shape() {}
+    virtual float Area() const = 0;
+};
+struct Circle : Shape
+{
+    float r;
+    Circle(float r_) : r(r_) {}
+    float Area() const { return 3.14159f * r * r; }
+};
+struct Rect : Shape
+{
+    float w, h;
+    Rect(float w_, float h_) : w(w_), h(h_) {}
+    float Area() const { return w * h; }
+};
+struct Triangle : Shape
+{
+    float b, h;
+    Triangle(float b_, float h_) : b(b_), h(h_) {}
+    float Area() const { return 0.5f * b * h; }
+};
+
+template <class Fn>
+void BenchmarkIteration(const char* pName, int count, Fn&& fn)
+{
+    const int iterations = 20;
+    float total = 0.0f;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int iter = 0; iter < iterations; ++iter)
+    {
+        total += fn();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%-40s %6.2f ns/elem (%g)\n", pName, ns / (double(count) * iterations), total);
+}
+
+// Sums Shape areas over randomly interleaved shapes, stored three ways.
+void BenchmarkPolyVector()
+{
+    const int count = 1000000;
+    std::vector<ci0::ClonePtr<Shape, 0>> ptrs;
+    ci0::PolyVector<Shape> shapes;
+    unsigned seed = 1;
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        float x = float(i % 7);
+        switch ((seed >> 16) % 3)
+        {
+        case 0: ptrs.push_back(ci0::MakeClone<Shape, Circle, 0>(x)); shapes.emplace_back<Circle>(x); break;
+        case 1: ptrs.push_back(ci0::MakeClone<Shape, Rect, 0>(x, 2.0f)); shapes.emplace_back<Rect>(x, 2.0f); break;
+        case 2: ptrs.push_back(ci0::MakeClone<Shape, Triangle, 0>(x, 3.0f)); shapes.emplace_back<Triangle>(x, 3.0f); break;
+        }
+    }
+    BenchmarkIteration("vector<ClonePtr<Shape, 0>>", count, [&]() {
+        float sum = 0.0f;
+        for (const auto& pShape : ptrs) { sum += pShape->Area(); }
+        return sum;
+    });
+    // heap objects of long-lived containers are rarely in allocation order; shuffle the pointers
+    for (int i = count - 1; i > 0; --i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        std::swap(ptrs[i], ptrs[(seed >> 8) % (i + 1)]);
+    }
+    BenchmarkIteration("vector<ClonePtr<Shape, 0>> (shuffled)", count, [&]() {
+        float sum = 0.0f;
+        for (const auto& pShape : ptrs) { sum += pShape->Area(); }
+        return sum;
+    });
+    BenchmarkIteration("PolyVector<Shape>", count, [&]() {
+        float sum = 0.0f;
+        for (const Shape& shape : shapes) { sum += shape.Area(); }
+        return sum;
+    });
+    BenchmarkIteration("PolyVector<Shape>::for_each_grouped", count, [&]() {
+        float sum = 0.0f;
+        shapes.for_each_grouped([&](const Shape& shape) { sum += shape.Area(); });
+        return sum;
+    });
+}
+
+// Reports the average time per call, and how often the by-value ArgCounter argument is copied and moved per call.
+template <class Fn>
+void BenchmarkCall(const char* pName, const Fn& fn)
+{
+    const int count = 1000000;
+    const std::string text(64, 'x'); // long enough to need a heap allocation per copy
+    ArgCounter arg(1);
+    ArgCounter::s_copyCount = ArgCounter::s_moveCount = 0;
+    size_t total = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        total += fn(text, arg);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%-40s %6.2f ns/call, copies=%g moves=%g (%zu)\n", pName, ns / count,
+        double(ArgCounter::s_copyCount) / count, double(ArgCounter::s_moveCount) / count, total);
+}
+
+void RunBenchmarks()
+{
+    int z = 3;
+    auto trivialLambda = [=](int x, int y) { return x + y + z; };
+    BenchmarkCopyDestroy("Function(trivial lambda)", ci0::Function<int(int, int)>(trivialLambda));
+    BenchmarkCopyDestroy("Function<16>(trivial lambda)", ci0::Function<int(int, int), 16>(trivialLambda));
+    BenchmarkCopyDestroy("CompactFunction(trivial lambda)", ci0::CompactFunction<int(int, int)>(trivialLambda));
+    BenchmarkCopyDestroy("std::function(trivial lambda)", std::function<int(int, int)>(trivialLambda));
+    BenchmarkCopyDestroy("ClonePtr<PodPoint>", ci0::ClonePtr<PodPoint>(PodPoint{ 1, 2 }));
+    BenchmarkCopyDestroy("ClonePtr<Base, 16>(RelocatableDerived)", ci0::ClonePtr<Base, 16>(RelocatableDerived(1)));
+    BenchmarkCopyDestroy("ClonePtr<Base>(Derived) [heap]", ci0::ClonePtr<Base>(Derived(1, 2)));
+    BenchmarkCopyDestroy("ClonePtr<Base, Pool>(Derived) [pool]", ci0::ClonePtr<Base, sizeof(void*), alignof(void*), ci0::ClonePtrPoolAllocator>(Derived(1, 2)));
+    BenchmarkPolyVector();
+    auto measure = [](std::string text, ArgCounter arg) { return text.size() + arg.value; };
+    BenchmarkCall("Function(string, ArgCounter)", ci0::Function<size_t(std::string, ArgCounter)>(measure));
+    BenchmarkCall("CompactFunction(string, ArgCounter)", ci0::CompactFunction<size_t(std::string, ArgCounter)>(measure));
+    BenchmarkCall("std::function(string, ArgCounter)", std::function<size_t(std::string, ArgCounter)>(measure));
+}
+#endif
+
 int main(int argc, char** argv)
 {
     TestUniquePtr();
     TestClonePtr();
+    TestClonePtrRelocation();
+    TestClonePtrCopyAssign();
+    TestAllocator();
+    TestClonePtrPool();
+    TestOwnershipTransfer();
+    TestInplacePtr();
+    TestAlignment();
     TestIntrusivePtr();
     TestFuncRef(argc);
     TestFunction(argc);
+    TestEmplace();
+    TestCowPtr();
+    TestExactTypeCast();
+    TestFunctionForwarding();
+    TestUniqueFunction();
+    TestTrivialFunction();
+    TestFixedFunction();
+    TestBindMember();
+    TestQualifiedSignature();
+    TestFunctionConversion();
+    TestCompactFunction();
+    TestFunctionDebug();
+    TestPolyVector();
+    TestClosedPolyPtr();
+#if ENABLE_BENCHMARKS
+    RunBenchmarks();
+#endif
     return 0;
 }
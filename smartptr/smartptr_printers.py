@@ -0,0 +1,116 @@
+# gdb pretty-printers for ci0::Function, ci0::FuncRef and ci0::CompactFunction.
+#
+# A Function holds no debug data; m_wrapperFn points at FuncBase<...>::ObjectAdapter<Obj>::Invoke,
+# so the symbol at that address names the function object type.
+# A CompactFunction's m_pDesc->wrapperFn points at CompactFuncBase<...>::ObjectAdapter<Obj, Locate>::Invoke.
+#
+# usage, from .gdbinit:
+#     python
+#     import sys; sys.path.insert(0, '/path/to/smartptr')
+#     import smartptr_printers; smartptr_printers.register(None)
+#     end
+
+import re
+import gdb
+import gdb.printing
+
+_adapterRe = re.compile(r'::ObjectAdapter<(.*)>::Invoke')
+_compactAdapterRe = re.compile(r'::ObjectAdapter<(.*), ci0::CompactFunction<.*>::(?:InSbo|OnHeap)>::Invoke')
+
+
+def _symbolName(addr):
+    block = gdb.block_for_pc(addr)
+    if block is not None and block.function is not None:
+        return block.function.print_name
+    # e.g. "ci0::FuncBase<int, int>::ObjectAdapter<Foo>::Invoke(char*, int) in section .text"
+    info = gdb.execute('info symbol 0x%x' % addr, to_string=True)
+    return info.split(' in section ')[0].strip()
+
+
+class FunctionPrinter(object):
+    def __init__(self, val):
+        self.val = val
+
+    def _targetTypeName(self):
+        match = _adapterRe.search(_symbolName(int(self.val['m_wrapperFn'])))
+        return match.group(1) if match else None
+
+    def to_string(self):
+        if int(self.val['m_wrapperFn']) == 0:
+            return 'empty'
+        typeName = self._targetTypeName()
+        if typeName is not None:
+            return typeName
+        wrapperName = _symbolName(int(self.val['m_wrapperFn']))
+        if '::MemberAdapter<' in wrapperName:
+            # a member function bound to the receiver in m_pObj
+            return '%s on 0x%x' % (wrapperName, int(self.val['m_pObj']))
+        # a raw function pointer is stored in m_pObj
+        return 'raw function %s' % _symbolName(int(self.val['m_pObj']))
+
+    def children(self):
+        pObj = self.val['m_pObj']
+        if int(self.val['m_wrapperFn']) == 0:
+            return
+        typeName = self._targetTypeName()
+        if typeName is None:
+            return
+        yield 'object', _objectChild(pObj, typeName)
+
+
+def _objectChild(pObj, typeName):
+    try:
+        objType = gdb.lookup_type(typeName)
+    except gdb.error:
+        # e.g. lambdas, whose printed names are not valid type names
+        return pObj.cast(gdb.lookup_type('void').pointer())
+    return pObj.cast(objType.pointer()).dereference()
+
+
+class CompactFunctionPrinter(object):
+    def __init__(self, val):
+        self.val = val
+
+    def _isEmpty(self):
+        return int(self.val['m_pDesc']) == 0
+
+    def _pObj(self):
+        voidPtr = gdb.lookup_type('void').pointer()
+        pSbo = self.val['m_sbo'].address.cast(voidPtr)
+        if bool(self.val['m_pDesc']['isInSbo']):
+            return pSbo
+        # the SBO holds a pointer to the object
+        return pSbo.cast(voidPtr.pointer()).dereference()
+
+    def _targetTypeName(self):
+        match = _compactAdapterRe.search(_symbolName(int(self.val['m_pDesc']['wrapperFn'])))
+        return match.group(1) if match else None
+
+    def to_string(self):
+        if self._isEmpty():
+            return 'empty'
+        if int(self.val['m_pDesc']['pCloner']) == 0:
+            # a raw function pointer is stored in the SBO
+            return 'raw function %s' % _symbolName(int(self._pObj().cast(gdb.lookup_type('void').pointer().pointer()).dereference()))
+        typeName = self._targetTypeName()
+        return typeName if typeName is not None else _symbolName(int(self.val['m_pDesc']['wrapperFn']))
+
+    def children(self):
+        if self._isEmpty() or int(self.val['m_pDesc']['pCloner']) == 0:
+            return
+        typeName = self._targetTypeName()
+        if typeName is None:
+            return
+        yield 'object', _objectChild(self._pObj(), typeName)
+
+
+def build_pretty_printer():
+    pp = gdb.printing.RegexpCollectionPrettyPrinter('smartptr')
+    pp.add_printer('Function', '^ci0::Function<.*>$', FunctionPrinter)
+    pp.add_printer('FuncRef', '^ci0::FuncRef<.*>$', FunctionPrinter)
+    pp.add_printer('CompactFunction', '^ci0::CompactFunction<.*>$', CompactFunctionPrinter)
+    return pp
+
+
+def register(objfile):
+    gdb.printing.register_pretty_printer(objfile, build_pretty_printer())